@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+//! Array of plain data whose first element starts on a cache line
+//! It either owns its elements or borrows them from memory that outlives it, such as a mapped file
+//! Elements are copied bytewise, copies of the array are deep and own their elements
+template <typename T>
+class AlignedArray {
+public:
+	enum { Alignment = 64 };
+
+	AlignedArray() : block(NULL), data(NULL), size(0) {}
+	AlignedArray(const AlignedArray& o) : block(NULL), data(NULL), size(0) { Assign(o.data, o.size); }
+	~AlignedArray() { free(block); }
+	AlignedArray& operator=(const AlignedArray& o) {
+		if (this != &o) Assign(o.data, o.size);
+		return *this;
+	}
+
+	//! Replaces the contents with a copy of values[0, n)
+	void Assign(const T* values, unsigned n) {
+		Clear();
+		if (n == 0) return;
+		block = malloc(n * sizeof(T) + Alignment - 1);
+		data = (T*)(((size_t)block + Alignment - 1) & ~(size_t)(Alignment - 1));
+		memcpy(data, values, n * sizeof(T));
+		size = n;
+	}
+	//! Replaces the contents with n zeroed elements of its own
+	void Resize(unsigned n) {
+		Clear();
+		if (n == 0) return;
+		block = calloc(n * sizeof(T) + Alignment - 1, 1);
+		data = (T*)(((size_t)block + Alignment - 1) & ~(size_t)(Alignment - 1));
+		size = n;
+	}
+	//! Refers to values[0, n) instead of copying them, they have to start on a cache line and stay until the array is cleared
+	//! A borrowed array cannot be written to
+	void Borrow(const T* values, unsigned n) {
+		assert(((size_t)values & (Alignment - 1)) == 0);
+		Clear();
+		data = const_cast<T*>(values);
+		size = n;
+	}
+	void Clear() {
+		free(block);
+		block = NULL;
+		data = NULL;
+		size = 0;
+	}
+
+	bool IsEmpty() const { return size == 0; }
+	unsigned GetSize() const { return size; }
+	const T* GetData() const { return data; }
+	const T& operator[](unsigned i) const {
+		assert(i < size);
+		return data[i];
+	}
+	T& operator[](unsigned i) {
+		assert(i < size && block);
+		return data[i];
+	}
+
+private:
+	void* block; // As allocated, data is the first aligned address in it
+	T* data;
+	unsigned size;
+};
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "animation.h"
+
+Transform Compose(const std::vector<TransformStep>& steps) {
+	Transform transform;
+	for (unsigned i = 0; i < steps.size(); i++) {
+		const TransformStep& step = steps[i];
+		switch (step.type) {
+		case TransformStep::Translation: transform = Translate(step.v) * transform; break;
+		case TransformStep::Rotation: transform = Rotate(step.angle, step.v) * transform; break;
+		case TransformStep::Scaling: transform = Scale(step.v.x, step.v.y, step.v.z) * transform; break;
+		}
+	}
+	return transform;
+}
+
+std::vector<TransformStep> Lerp(float t, const std::vector<TransformStep>& a, const std::vector<TransformStep>& b) {
+	assert(a.size() == b.size());
+	std::vector<TransformStep> steps(a.size());
+	for (unsigned i = 0; i < a.size(); i++) {
+		assert(a[i].type == b[i].type);
+		steps[i] = TransformStep(a[i].type, Lerp(t, a[i].v, b[i].v), Lerp(t, a[i].angle, b[i].angle));
+	}
+	return steps;
+}
+
+CameraKey Lerp(float t, const CameraKey& a, const CameraKey& b) {
+	return CameraKey(Lerp(t, a.position, b.position), Lerp(t, a.direction, b.direction), Lerp(t, a.up, b.up));
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "transform.h"
+#include <vector>
+
+//! One of the simple transforms an animated transform is built from
+struct TransformStep {
+	enum Type { Translation, Rotation, Scaling };
+
+	TransformStep() : type(Translation), angle(0.f) {}
+	TransformStep(Type type, const Vector& v, float angle = 0.f) : type(type), v(v), angle(angle) {}
+
+	Type type;
+	Vector v; // Offset, rotation axis or scale factors
+	float angle; // Of rotations, in degrees
+};
+
+//! Applies the steps in order
+Transform Compose(const std::vector<TransformStep>& steps);
+
+//! Where the camera is and where it looks at a keyframe
+struct CameraKey {
+	CameraKey() {}
+	CameraKey(const Point& position, const Vector& direction, const Vector& up) : position(position), direction(direction), up(up) {}
+
+	Point position;
+	Vector direction, up; // Need not be normalized or perpendicular
+};
+
+//! Interpolates every parameter of the steps, a and b need the same types of steps in the same order
+//! Unlike interpolating the transforms this keeps rotations rigid, however far they turn
+std::vector<TransformStep> Lerp(float t, const std::vector<TransformStep>& a, const std::vector<TransformStep>& b);
+CameraKey Lerp(float t, const CameraKey& a, const CameraKey& b);
+
+//! Values of a property at increasing times, linearly interpolated in between
+//! The first value holds before the first key and the last one after the last key
+template <typename T>
+class Track {
+public:
+	//! Keys have to be added in order of time
+	void AddKey(float time, const T& value) {
+		assert(times.empty() || time > times.back());
+		times.push_back(time);
+		values.push_back(value);
+	}
+
+	bool IsEmpty() const { return times.empty(); }
+	const std::vector<float>& GetTimes() const { return times; }
+	const std::vector<T>& GetValues() const { return values; }
+
+	T Evaluate(float time) const {
+		assert(!times.empty());
+		if (time <= times.front()) return values.front();
+		if (time >= times.back()) return values.back();
+		unsigned i = (unsigned)(std::upper_bound(times.begin(), times.end(), time) - times.begin());
+		return Lerp((time - times[i - 1]) / (times[i] - times[i - 1]), values[i - 1], values[i]);
+	}
+
+private:
+	std::vector<float> times;
+	std::vector<T> values; // Parallel to times
+};
\ No newline at end of file
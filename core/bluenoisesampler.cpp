@@ -0,0 +1,113 @@
+#include "bluenoisesampler.h"
+#include <algorithm>
+#include <cmath>
+
+//! Sets or clears pixel p of the pattern and updates the energy, which is the pattern blurred by kernel
+static void Toggle(std::vector<unsigned char>& pattern, std::vector<float>& energy, const std::vector<float>& kernel,
+	unsigned size, unsigned p, bool on) {
+	pattern[p] = on ? 1 : 0;
+	float sign = on ? 1.f : -1.f;
+	unsigned px = p % size, py = p / size;
+	for (unsigned y = 0; y < size; y++) {
+		const float* row = &kernel[((y - py) & (size - 1)) * size];
+		for (unsigned x = 0; x < size; x++)
+			energy[y * size + x] += sign * row[(x - px) & (size - 1)];
+	}
+}
+
+//! Set pixel with the highest energy if cluster, otherwise the empty pixel with the lowest energy
+static unsigned Find(const std::vector<unsigned char>& pattern, const std::vector<float>& energy, bool cluster) {
+	unsigned best = 0;
+	bool found = false;
+	for (unsigned i = 0; i < pattern.size(); i++) {
+		if ((pattern[i] != 0) != cluster) continue;
+		if (!found || (cluster ? energy[i] > energy[best] : energy[i] < energy[best])) {
+			best = i;
+			found = true;
+		}
+	}
+	return best;
+}
+
+//! Builds a blue noise mask with the void and cluster method
+//! Every pixel gets a rank: pixels with ranks below any threshold are spread out evenly
+//! The mask value of a pixel is its rank as a 32 bit fraction
+static std::vector<unsigned>* BuildMask(unsigned size, unsigned seed) {
+	const unsigned n = size * size;
+	const float sigma = 1.5f;
+
+	// Gaussian weight of every offset on the torus
+	std::vector<float> kernel(n);
+	for (unsigned y = 0; y < size; y++) {
+		for (unsigned x = 0; x < size; x++) {
+			float dx = (float)std::min(x, size - x), dy = (float)std::min(y, size - y);
+			kernel[y * size + x] = expf(-(dx * dx + dy * dy) / (2.f * sigma * sigma));
+		}
+	}
+
+	std::vector<unsigned char> pattern(n, 0);
+	std::vector<float> energy(n, 0.f);
+	unsigned nOnes = 0;
+
+	// Random initial pattern, relaxed by moving the tightest cluster into the largest void until that changes nothing
+	RNG rng(seed);
+	while (nOnes < n / 10) {
+		unsigned p = rng.UniformUInt() % n;
+		if (pattern[p]) continue;
+		Toggle(pattern, energy, kernel, size, p, true);
+		nOnes++;
+	}
+	for (unsigned i = 0; i < n; i++) {
+		unsigned cluster = Find(pattern, energy, true);
+		Toggle(pattern, energy, kernel, size, cluster, false);
+		unsigned hole = Find(pattern, energy, false);
+		Toggle(pattern, energy, kernel, size, hole, true);
+		if (hole == cluster) break;
+	}
+
+	std::vector<unsigned> rank(n);
+	std::vector<unsigned char> prototype = pattern;
+	std::vector<float> prototypeEnergy = energy;
+
+	// Ranks below the initial pattern: take away the tightest clusters
+	for (unsigned r = nOnes; r > 0; r--) {
+		unsigned cluster = Find(pattern, energy, true);
+		Toggle(pattern, energy, kernel, size, cluster, false);
+		rank[cluster] = r - 1;
+	}
+	// Ranks above it: fill the largest voids
+	pattern = prototype;
+	energy = prototypeEnergy;
+	for (unsigned r = nOnes; r < n; r++) {
+		unsigned hole = Find(pattern, energy, false);
+		Toggle(pattern, energy, kernel, size, hole, true);
+		rank[hole] = r;
+	}
+
+	std::vector<unsigned>* mask = new std::vector<unsigned>(n);
+	for (unsigned i = 0; i < n; i++)
+		(*mask)[i] = (unsigned)(((double)rank[i] + 0.5) / n * 4294967296.0);
+	return mask;
+}
+
+BlueNoiseSampler::BlueNoiseSampler(unsigned seed) : Sampler(seed), mask(BuildMask(MaskSize, seed)) {}
+
+//! Mask value of the current pixel for dimension d, the mask is shifted by an offset that depends on d only
+unsigned BlueNoiseSampler::MaskValue(unsigned d) const {
+	unsigned offset = HashCombine(seed, d);
+	unsigned mx = (x + offset) & (MaskSize - 1);
+	unsigned my = (y + (offset >> 16)) & (MaskSize - 1);
+	return (*mask)[my * MaskSize + mx];
+}
+
+float BlueNoiseSampler::Get1D() {
+	// Golden ratio as a 32 bit fraction
+	return BitsToFloat(MaskValue(dimension++) + index * 2654435769u);
+}
+
+void BlueNoiseSampler::Get2D(float* u1, float* u2) {
+	// R2 sequence, the two dimensional generalisation of the golden ratio sequence
+	*u1 = BitsToFloat(MaskValue(dimension) + index * 3242174889u);
+	*u2 = BitsToFloat(MaskValue(dimension + 1) + index * 2447445414u);
+	dimension += 2;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "sampler.h"
+#include <memory>
+#include <vector>
+
+//! Spreads the error over the image as blue noise, which looks smoother than white noise at low sample counts
+//! Each dimension reads a tiled blue noise mask, shifted by a different offset per dimension,
+//! and successive samples add a golden ratio sequence to it so that every pixel stays stratified over time
+class BlueNoiseSampler : public Sampler {
+public:
+	explicit BlueNoiseSampler(unsigned seed = 0);
+
+	float Get1D();
+	void Get2D(float* u1, float* u2);
+	Sampler* Clone() const { return new BlueNoiseSampler(*this); }
+
+private:
+	enum { MaskSize = 64 }; // Power of two
+
+	unsigned MaskValue(unsigned d) const;
+
+	std::shared_ptr<const std::vector<unsigned> > mask; // Shared by the clones of a sampler
+};
\ No newline at end of file
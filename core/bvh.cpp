@@ -0,0 +1,781 @@
+#include "bvh.h"
+#include "simd.h"
+#include "sphere.h"
+#include "trianglemesh.h"
+#include <algorithm>
+#include <cstring>
+
+PrimitiveKind BVH::GetKind(const Shape* shape) {
+	switch (shape->GetType()) {
+	case SphereShape: return SpherePrimitive;
+	case TriangleShape: case MeshTriangleShape: return TrianglePrimitive;
+	default: return OtherPrimitive;
+	}
+}
+
+//! Bounds and centroid of a single shape, used while building
+struct BVHPrimitiveInfo {
+	BVHPrimitiveInfo(unsigned primitiveNumber, const BBox& b, PrimitiveKind kind)
+		: primitiveNumber(primitiveNumber), bounds(b), kind(kind) {
+		centroid = b.pMin * .5f + b.pMax * .5f;
+	}
+	unsigned primitiveNumber;
+	Point centroid;
+	BBox bounds;
+	PrimitiveKind kind;
+};
+
+//! Node of the pointer-based tree that is flattened after building
+struct BVHBuildNode {
+	BVHBuildNode() : splitAxis(0), firstPrimOffset(0), nPrimitives(0), kind(OtherPrimitive) { children[0] = children[1] = NULL; }
+
+	//! first is the offset in the list of shapes of the kind
+	void InitLeaf(unsigned first, unsigned n, PrimitiveKind k, const BBox& b) {
+		firstPrimOffset = first;
+		nPrimitives = n;
+		kind = k;
+		bounds = b;
+	}
+	void InitInterior(unsigned axis, BVHBuildNode* c0, BVHBuildNode* c1) {
+		children[0] = c0;
+		children[1] = c1;
+		bounds = bounds.Union(c0->bounds, c1->bounds);
+		splitAxis = axis;
+		nPrimitives = 0;
+	}
+
+	BBox bounds;
+	BVHBuildNode* children[2];
+	unsigned splitAxis, firstPrimOffset, nPrimitives;
+	PrimitiveKind kind;
+};
+
+//! Bucket used to evaluate the surface area heuristic
+struct BucketInfo {
+	BucketInfo() : count(0) {}
+	unsigned count;
+	BBox bounds;
+};
+
+//! Builds the hierarchy over shapes, replacing any previous hierarchy
+void BVH::Build(const std::vector<Shape*>& shapes, bool motion) {
+	primitives.clear();
+	nodes.clear();
+	endBounds.clear();
+	spheres.Clear();
+	triangles.Clear();
+	wideNodes.Clear();
+	for (unsigned i = 0; i <= PrimitiveKinds; i++)
+		kindStart[i] = 0;
+	if (shapes.empty()) return;
+
+	std::vector<BVHPrimitiveInfo> buildData;
+	buildData.reserve(shapes.size());
+	for (unsigned i = 0; i < shapes.size(); i++)
+		buildData.push_back(BVHPrimitiveInfo(i, shapes[i]->GetBounds(), GetKind(shapes[i])));
+
+	unsigned totalNodes = 0;
+	std::vector<Shape*> orderedPrims[PrimitiveKinds];
+	BVHBuildNode* root = RecursiveBuild(shapes, buildData, 0, (unsigned)shapes.size(), &totalNodes, orderedPrims);
+	// The kinds follow each other, Flatten moves the offsets of the leaves to where their kind starts
+	primitives.reserve(shapes.size());
+	for (unsigned kind = 0; kind < PrimitiveKinds; kind++) {
+		kindStart[kind] = (unsigned)primitives.size();
+		primitives.insert(primitives.end(), orderedPrims[kind].begin(), orderedPrims[kind].end());
+	}
+	kindStart[PrimitiveKinds] = (unsigned)primitives.size();
+	FillPrimitiveArrays();
+
+	nodes.resize(totalNodes);
+	unsigned offset = 0;
+	Flatten(root, &offset);
+	assert(offset == totalNodes);
+	FreeBuildTree(root);
+
+	// The tree is split on the bounds over the whole interval, the nodes get the bounds at either end
+	if (motion) {
+		endBounds.resize(nodes.size());
+		Refit();
+	}
+	else {
+		Collapse();
+	}
+}
+
+//! Children come after their parent in the node array, so going backwards visits them first
+void BVH::Refit() {
+	bool motion = !endBounds.empty();
+	for (unsigned i = (unsigned)nodes.size(); i-- > 0; ) {
+		LinearBVHNode& node = nodes[i];
+		BBox start, end;
+		if (node.nPrimitives > 0) {
+			for (unsigned j = 0; j < node.nPrimitives; j++) {
+				const Shape* prim = primitives[node.primitivesOffset + j];
+				start = start.Union(start, motion ? prim->GetBoundsAt(0.f) : prim->GetBounds());
+				if (motion) end = end.Union(end, prim->GetBoundsAt(1.f));
+			}
+		}
+		else {
+			start = start.Union(nodes[i + 1].bounds, nodes[node.secondChildOffset].bounds);
+			if (motion) end = end.Union(endBounds[i + 1], endBounds[node.secondChildOffset]);
+		}
+		node.bounds = start;
+		if (motion) endBounds[i] = end;
+	}
+	FillPrimitiveArrays();
+	Collapse();
+}
+
+//! Only works out where the kinds start, everything else derived from nodes and primitives is in arrays
+void BVH::Restore(std::vector<LinearBVHNode>& nodes, const std::vector<Shape*>& primitives, const BVHArrays& arrays) {
+	this->nodes.swap(nodes);
+	this->primitives = primitives;
+	endBounds.clear();
+	unsigned count[PrimitiveKinds] = { 0, 0, 0 };
+	for (unsigned i = 0; i < primitives.size(); i++) {
+		PrimitiveKind kind = GetKind(primitives[i]);
+		assert(i == 0 || kind >= GetKind(primitives[i - 1]));
+		count[kind]++;
+	}
+	kindStart[0] = 0;
+	for (unsigned kind = 0; kind < PrimitiveKinds; kind++)
+		kindStart[kind + 1] = kindStart[kind] + count[kind];
+	assert(arrays.nWideNodes > 0 || this->nodes.empty());
+	wideNodes.Borrow(arrays.wideNodes, arrays.nWideNodes);
+	spheres.Borrow(arrays.spheres, arrays.sphereArraySize);
+	triangles.Borrow(arrays.triangles, arrays.triangleArraySize);
+}
+
+void BVH::GetArrays(BVHArrays& arrays) const {
+	arrays.wideNodes = wideNodes.GetData();
+	arrays.nWideNodes = wideNodes.GetSize();
+	for (unsigned i = 0; i < SphereSoA::Arrays; i++)
+		arrays.spheres[i] = spheres.GetArray(i);
+	arrays.sphereArraySize = spheres.GetArraySize();
+	for (unsigned i = 0; i < TriangleSoA::Arrays; i++)
+		arrays.triangles[i] = triangles.GetArray(i);
+	arrays.triangleArraySize = triangles.GetArraySize();
+}
+
+//! Copies the spheres and triangles into their arrays, in the order primitives lists them
+//! Triangles are taken from their vertices, they keep no edges of their own
+void BVH::FillPrimitiveArrays() {
+	unsigned nSpheres = kindStart[SpherePrimitive + 1] - kindStart[SpherePrimitive];
+	spheres.Resize(nSpheres);
+	for (unsigned i = 0; i < nSpheres; i++) {
+		const Sphere* sphere = static_cast<const Sphere*>(primitives[kindStart[SpherePrimitive] + i]);
+		spheres.Set(i, sphere->center, sphere->radius);
+	}
+	unsigned nTriangles = kindStart[TrianglePrimitive + 1] - kindStart[TrianglePrimitive];
+	triangles.Resize(nTriangles);
+	for (unsigned i = 0; i < nTriangles; i++) {
+		const Shape* shape = primitives[kindStart[TrianglePrimitive] + i];
+		Point p1, p2, p3;
+		if (shape->GetType() == TriangleShape) {
+			const Triangle* triangle = static_cast<const Triangle*>(shape);
+			p1 = triangle->p1;
+			p2 = triangle->p2;
+			p3 = triangle->p3;
+		}
+		else {
+			static_cast<const MeshTriangle*>(shape)->GetVertices(p1, p2, p3);
+		}
+		triangles.Set(i, p1, p2, p3);
+	}
+}
+
+//! Builds the subtree over buildData[start, end) and appends its shapes to the lists of their kinds in orderedPrims
+BVHBuildNode* BVH::RecursiveBuild(const std::vector<Shape*>& shapes, std::vector<BVHPrimitiveInfo>& buildData, unsigned start, unsigned end,
+	unsigned* totalNodes, std::vector<Shape*>* orderedPrims) {
+	assert(start < end);
+	(*totalNodes)++;
+	BVHBuildNode* node = new BVHBuildNode();
+
+	// Bounds of all shapes in this node
+	BBox bounds;
+	for (unsigned i = start; i < end; i++)
+		bounds = bounds.Union(bounds, buildData[i].bounds);
+
+	unsigned nPrimitives = end - start;
+	if (nPrimitives == 1) {
+		MakeLeaf(node, shapes, buildData, start, end, bounds, totalNodes, orderedPrims);
+		return node;
+	}
+
+	// Choose split dimension on the extent of the centroids
+	BBox centroidBounds;
+	for (unsigned i = start; i < end; i++)
+		centroidBounds = centroidBounds.Union(centroidBounds, buildData[i].centroid);
+	unsigned dim = centroidBounds.MaximumExtent();
+
+	if (centroidBounds.pMax[dim] == centroidBounds.pMin[dim]) {
+		// All centroids coincide, nothing to split on
+		// A leaf counts its shapes in 16 bits, so larger sets are halved in whatever order they are until they fit
+		if (nPrimitives <= MaxLeafPrimitives) {
+			MakeLeaf(node, shapes, buildData, start, end, bounds, totalNodes, orderedPrims);
+			return node;
+		}
+		unsigned mid = start + nPrimitives / 2;
+		node->InitInterior(dim,
+			RecursiveBuild(shapes, buildData, start, mid, totalNodes, orderedPrims),
+			RecursiveBuild(shapes, buildData, mid, end, totalNodes, orderedPrims));
+		return node;
+	}
+
+	// Bin the centroids and evaluate the surface area heuristic at every bucket boundary
+	const unsigned nBuckets = 12;
+	BucketInfo buckets[nBuckets];
+	float cMin = centroidBounds.pMin[dim];
+	float cExtent = centroidBounds.pMax[dim] - cMin;
+	for (unsigned i = start; i < end; i++) {
+		unsigned b = (unsigned)(nBuckets * ((buildData[i].centroid[dim] - cMin) / cExtent));
+		if (b == nBuckets) b = nBuckets - 1;
+		buckets[b].count++;
+		buckets[b].bounds = buckets[b].bounds.Union(buckets[b].bounds, buildData[i].bounds);
+	}
+
+	// Cost of splitting after each bucket, relative to an intersection test costing 1
+	float cost[nBuckets - 1];
+	for (unsigned i = 0; i < nBuckets - 1; i++) {
+		BBox b0, b1;
+		unsigned count0 = 0, count1 = 0;
+		for (unsigned j = 0; j <= i; j++) {
+			b0 = b0.Union(b0, buckets[j].bounds);
+			count0 += buckets[j].count;
+		}
+		for (unsigned j = i+1; j < nBuckets; j++) {
+			b1 = b1.Union(b1, buckets[j].bounds);
+			count1 += buckets[j].count;
+		}
+		float area0 = count0 ? b0.SurfaceArea() : 0.f;
+		float area1 = count1 ? b1.SurfaceArea() : 0.f;
+		cost[i] = .125f + (count0 * area0 + count1 * area1) / bounds.SurfaceArea();
+	}
+
+	float minCost = cost[0];
+	unsigned minCostSplit = 0;
+	for (unsigned i = 1; i < nBuckets - 1; i++) {
+		if (cost[i] < minCost) {
+			minCost = cost[i];
+			minCostSplit = i;
+		}
+	}
+
+	// Spheres and triangles in a leaf are tested SIMD_WIDTH at a time, so a batch costs as much as one other shape
+	unsigned count[PrimitiveKinds] = { 0, 0, 0 };
+	for (unsigned i = start; i < end; i++)
+		count[buildData[i].kind]++;
+	float leafCost = (float)((count[SpherePrimitive] + SIMD_WIDTH - 1) / SIMD_WIDTH +
+		(count[TrianglePrimitive] + SIMD_WIDTH - 1) / SIMD_WIDTH + count[OtherPrimitive]);
+	if (nPrimitives <= maxPrimsInNode && minCost >= leafCost) {
+		// Splitting is more expensive than testing every shape
+		MakeLeaf(node, shapes, buildData, start, end, bounds, totalNodes, orderedPrims);
+		return node;
+	}
+
+	BVHPrimitiveInfo* pmid = std::partition(&buildData[start], &buildData[end-1]+1,
+		[=](const BVHPrimitiveInfo& p) {
+			unsigned b = (unsigned)(nBuckets * ((p.centroid[dim] - cMin) / cExtent));
+			if (b == nBuckets) b = nBuckets - 1;
+			return b <= minCostSplit;
+		});
+	unsigned mid = (unsigned)(pmid - &buildData[0]);
+	if (mid == start || mid == end)
+		mid = (start + end) / 2;
+
+	node->InitInterior(dim,
+		RecursiveBuild(shapes, buildData, start, mid, totalNodes, orderedPrims),
+		RecursiveBuild(shapes, buildData, mid, end, totalNodes, orderedPrims));
+	return node;
+}
+
+//! Turns node into a leaf over buildData[start, end), or into a subtree with a leaf per kind if the shapes are of several kinds
+void BVH::MakeLeaf(BVHBuildNode* node, const std::vector<Shape*>& shapes, std::vector<BVHPrimitiveInfo>& buildData,
+	unsigned start, unsigned end, const BBox& bounds, unsigned* totalNodes, std::vector<Shape*>* orderedPrims) {
+	PrimitiveKind kind = buildData[start].kind;
+	BVHPrimitiveInfo* pmid = std::partition(&buildData[start], &buildData[end-1]+1,
+		[=](const BVHPrimitiveInfo& p) { return p.kind == kind; });
+	unsigned mid = (unsigned)(pmid - &buildData[0]);
+	if (mid < end) {
+		BBox b0, b1;
+		for (unsigned i = start; i < mid; i++)
+			b0 = b0.Union(b0, buildData[i].bounds);
+		for (unsigned i = mid; i < end; i++)
+			b1 = b1.Union(b1, buildData[i].bounds);
+		BVHBuildNode* c0 = new BVHBuildNode();
+		BVHBuildNode* c1 = new BVHBuildNode();
+		*totalNodes += 2;
+		MakeLeaf(c0, shapes, buildData, start, mid, b0, totalNodes, orderedPrims);
+		MakeLeaf(c1, shapes, buildData, mid, end, b1, totalNodes, orderedPrims);
+		node->InitInterior(bounds.MaximumExtent(), c0, c1);
+		return;
+	}
+	std::vector<Shape*>& ordered = orderedPrims[kind];
+	unsigned first = (unsigned)ordered.size();
+	for (unsigned i = start; i < end; i++)
+		ordered.push_back(shapes[buildData[i].primitiveNumber]);
+	node->InitLeaf(first, end - start, kind, bounds);
+}
+
+//! Writes the subtree under node to the linear node array in depth-first order
+unsigned BVH::Flatten(BVHBuildNode* node, unsigned* offset) {
+	LinearBVHNode& linearNode = nodes[*offset];
+	linearNode.bounds = node->bounds;
+	unsigned myOffset = (*offset)++;
+	if (node->nPrimitives > 0) {
+		assert(!node->children[0] && !node->children[1]);
+		assert(node->nPrimitives <= MaxLeafPrimitives);
+		linearNode.primitivesOffset = kindStart[node->kind] + node->firstPrimOffset;
+		linearNode.nPrimitives = (unsigned short)node->nPrimitives;
+		linearNode.axis = 0;
+		linearNode.kind = (unsigned char)node->kind;
+	}
+	else {
+		linearNode.axis = (unsigned char)node->splitAxis;
+		linearNode.nPrimitives = 0;
+		linearNode.kind = 0;
+		Flatten(node->children[0], offset);
+		nodes[myOffset].secondChildOffset = Flatten(node->children[1], offset);
+	}
+	return myOffset;
+}
+
+void BVH::FreeBuildTree(BVHBuildNode* node) {
+	if (!node) return;
+	FreeBuildTree(node->children[0]);
+	FreeBuildTree(node->children[1]);
+	delete node;
+}
+
+//! Grid step that covers [lo, hi] in 255 steps, rounded up so that the last step reaches hi
+static float GridScale(float lo, float hi) {
+	if (!(hi > lo)) return 0.f;
+	float scale = (hi - lo) / 255.f;
+	while (lo + 255.f * scale < hi)
+		scale *= 1.00000024f;
+	return scale;
+}
+
+//! Largest grid step at or below v, computed the way traversal turns it back into a float
+static unsigned char QuantizeDown(float v, float origin, float scale) {
+	if (scale == 0.f) return 0;
+	int q = std::min(std::max((int)floorf((v - origin) / scale), 0), 255);
+	while (q > 0 && origin + (float)q * scale > v) q--;
+	return (unsigned char)q;
+}
+
+//! Smallest grid step at or above v
+static unsigned char QuantizeUp(float v, float origin, float scale) {
+	if (scale == 0.f) return 0;
+	int q = std::min(std::max((int)ceilf((v - origin) / scale), 0), 255);
+	while (q < 255 && origin + (float)q * scale < v) q++;
+	return (unsigned char)q;
+}
+
+//! Turns the binary nodes into wide ones, the binary nodes stay for packets, refitting and the cache
+void BVH::Collapse() {
+	wideNodes.Clear();
+	if (nodes.empty() || HasMotion()) return;
+	std::vector<WideBVHNode> wide;
+	wide.reserve(nodes.size() / 4 + 1);
+	CollapseNode(0, wide);
+	wideNodes.Assign(&wide[0], (unsigned)wide.size());
+}
+
+//! Makes a wide node out of the binary subtree under root, repeatedly opening up the interior child with
+//! the largest surface area until every slot is used, and returns its index
+unsigned BVH::CollapseNode(unsigned root, std::vector<WideBVHNode>& wide) const {
+	const unsigned width = WideBVHNode::Width;
+	unsigned children[width];
+	unsigned nChildren = 0;
+	const LinearBVHNode& node = nodes[root];
+	if (node.nPrimitives > 0) {
+		// Only a tree that is a single leaf gets here
+		children[nChildren++] = root;
+	}
+	else {
+		children[nChildren++] = root + 1;
+		children[nChildren++] = node.secondChildOffset;
+	}
+	while (nChildren < width) {
+		unsigned largest = width;
+		float largestArea = -1.f;
+		for (unsigned i = 0; i < nChildren; i++) {
+			const LinearBVHNode& child = nodes[children[i]];
+			if (child.nPrimitives == 0 && child.bounds.SurfaceArea() > largestArea) {
+				largest = i;
+				largestArea = child.bounds.SurfaceArea();
+			}
+		}
+		if (largest == width) break;
+		unsigned opened = children[largest];
+		children[largest] = opened + 1;
+		children[nChildren++] = nodes[opened].secondChildOffset;
+	}
+
+	unsigned index = (unsigned)wide.size();
+	wide.push_back(WideBVHNode());
+	unsigned childIndices[width];
+	for (unsigned i = 0; i < nChildren; i++)
+		childIndices[i] = nodes[children[i]].nPrimitives > 0 ? 0 : CollapseNode(children[i], wide);
+
+	// The vector may have grown in between
+	WideBVHNode& w = wide[index];
+	memset(&w, 0, sizeof(w));
+	memset(w.bounds[0], 255, sizeof(w.bounds[0]));
+	for (unsigned a = 0; a < 3; a++) {
+		w.origin[a] = node.bounds.pMin[a];
+		w.scale[a] = GridScale(node.bounds.pMin[a], node.bounds.pMax[a]);
+	}
+	for (unsigned i = 0; i < nChildren; i++) {
+		const LinearBVHNode& child = nodes[children[i]];
+		for (unsigned a = 0; a < 3; a++) {
+			w.bounds[0][a][i] = QuantizeDown(child.bounds.pMin[a], w.origin[a], w.scale[a]);
+			w.bounds[1][a][i] = QuantizeUp(child.bounds.pMax[a], w.origin[a], w.scale[a]);
+		}
+		if (child.nPrimitives > 0) {
+			w.child[i] = child.primitivesOffset;
+			w.nPrimitives[i] = child.nPrimitives;
+			w.kind[i] = child.kind;
+		}
+		else {
+			w.child[i] = childIndices[i];
+		}
+	}
+	return index;
+}
+
+//! A ray prepared for testing against the children of wide nodes
+struct WideBVHRay {
+	WideBVHRay(const Ray& ray) : mint(ray.mint), robust(1.00000024f) {
+		for (unsigned a = 0; a < 3; a++) {
+			float inverse = 1.f / ray.d[a];
+			// Which of the child bounds is the near plane only depends on the sign of the direction
+			dirIsNeg[a] = inverse < 0.f;
+			o[a] = vfloat(ray.o[a]);
+			inv[a] = vfloat(inverse);
+		}
+	}
+
+	unsigned dirIsNeg[3];
+	vfloat o[3], inv[3];
+	vfloat mint, robust;
+};
+
+//! Slab test of the ray against all children of node at once, SIMD_WIDTH at a time
+//! Returns a bit for every child the ray enters before tMax, and stores the distances at which it does in tNear
+static int IntersectChildren(const WideBVHNode& node, const WideBVHRay& ray, float tMax, float* tNear) {
+	vfloat t0[3], t1[3];
+	int hits = 0;
+	for (unsigned i = 0; i < WideBVHNode::Width; i += SIMD_WIDTH) {
+		for (unsigned a = 0; a < 3; a++) {
+			vfloat origin(node.origin[a]), scale(node.scale[a]);
+			t0[a] = (origin + vfloat::LoadBytes(&node.bounds[ray.dirIsNeg[a]][a][i]) * scale - ray.o[a]) * ray.inv[a];
+			t1[a] = (origin + vfloat::LoadBytes(&node.bounds[1 - ray.dirIsNeg[a]][a][i]) * scale - ray.o[a]) * ray.inv[a];
+		}
+		vfloat tEnter = Max(Max(t0[0], t0[1]), Max(t0[2], ray.mint));
+		vfloat tExit = Min(Min(Min(t1[0], t1[1]), t1[2]) * ray.robust, vfloat(tMax));
+		tEnter.Store(&tNear[i]);
+		hits |= (tEnter <= tExit).Bits() << i;
+	}
+	return hits;
+}
+
+//! Unused slots never hold a leaf and refer to node 0, which is never a child
+static bool IsEmptySlot(const WideBVHNode& node, unsigned i) {
+	return node.nPrimitives[i] == 0 && node.child[i] == 0;
+}
+
+//! A child of a wide node waiting to be visited, with the distance at which the ray enters it
+struct WideBVHEntry {
+	float tNear;
+	unsigned child;
+	unsigned short nPrimitives;
+	unsigned char kind;
+};
+
+//! Tests the shapes of a leaf, which are all of one kind, so that only shapes that are neither spheres nor triangles need virtual calls
+//! Lowers closest and sets b1, b2 and index when it finds a hit closer than it, with AnyHit the first such hit will do
+template <bool AnyHit>
+bool BVH::IntersectLeaf(const Ray& ray, unsigned first, unsigned nPrimitives, unsigned kind,
+	float& closest, float& b1, float& b2, unsigned& index) const {
+	float tHit, b1Hit = 0.f, b2Hit = 0.f;
+	unsigned hitIndex;
+	switch (kind) {
+	case SpherePrimitive:
+		if (!spheres.Intersect(ray, first - kindStart[SpherePrimitive], nPrimitives, closest, tHit, hitIndex)) return false;
+		hitIndex += kindStart[SpherePrimitive];
+		break;
+	case TrianglePrimitive:
+		if (!triangles.Intersect(ray, first - kindStart[TrianglePrimitive], nPrimitives, closest, tHit, b1Hit, b2Hit, hitIndex)) return false;
+		hitIndex += kindStart[TrianglePrimitive];
+		break;
+	default: {
+		bool found = false;
+		for (unsigned i = first; i < first + nPrimitives; i++) {
+			float t, u, v;
+			if (primitives[i]->Intersect(ray, t, u, v) && t < closest && t > 0.f) {
+				closest = t;
+				b1 = u;
+				b2 = v;
+				index = i;
+				found = true;
+				if (AnyHit) break;
+			}
+		}
+		return found;
+	}
+	}
+	closest = tHit;
+	b1 = b1Hit;
+	b2 = b2Hit;
+	index = hitIndex;
+	return true;
+}
+
+//! Finds the closest shape hit by the ray, and the barycentric coordinates of the hit on it
+//! All children of a wide node are tested at once, those that are hit are visited nearest first
+bool BVH::Intersect(const Ray& ray, Hit& hit) const {
+	if (wideNodes.IsEmpty()) return false;
+	assert(!HasMotion());
+
+	const unsigned width = WideBVHNode::Width;
+	WideBVHRay wideRay(ray);
+	float closest = ray.maxt;
+	float closestB1 = 0.f, closestB2 = 0.f;
+	unsigned closestPrimitive = 0;
+	bool found = false;
+	// Every level pushes at most width - 1 entries on top of the one it pops
+	WideBVHEntry todo[WideStackSize];
+	unsigned todoOffset = 0, nodeNum = 0;
+	while (true) {
+		const WideBVHNode& node = wideNodes[nodeNum];
+		float tNear[width];
+		int hits = IntersectChildren(node, wideRay, closest, tNear);
+
+		// Push the children that are hit farthest first, so that the nearest one is popped first
+		unsigned order[width];
+		unsigned nHits = 0;
+		for (unsigned i = 0; hits; i++, hits >>= 1) {
+			if (!(hits & 1) || IsEmptySlot(node, i)) continue;
+			unsigned j = nHits++;
+			for (; j > 0 && tNear[order[j - 1]] < tNear[i]; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+		assert(todoOffset + nHits <= sizeof(todo) / sizeof(todo[0]));
+		for (unsigned j = 0; j < nHits; j++) {
+			unsigned i = order[j];
+			WideBVHEntry& entry = todo[todoOffset++];
+			entry.tNear = tNear[i];
+			entry.child = node.child[i];
+			entry.nPrimitives = node.nPrimitives[i];
+			entry.kind = node.kind[i];
+		}
+
+		// Leaves are intersected as they come off the stack, until an interior node turns up
+		bool descend = false;
+		while (todoOffset > 0 && !descend) {
+			const WideBVHEntry& entry = todo[--todoOffset];
+			if (entry.tNear > closest) continue;
+			if (entry.nPrimitives == 0) {
+				nodeNum = entry.child;
+				descend = true;
+				continue;
+			}
+			found |= IntersectLeaf<false>(ray, entry.child, entry.nPrimitives, entry.kind, closest, closestB1, closestB2, closestPrimitive);
+		}
+		if (!descend) break;
+	}
+
+	if (!found) return false;
+	hit.t = closest;
+	hit.b1 = closestB1;
+	hit.b2 = closestB2;
+	hit.shape = primitives[closestPrimitive];
+	hit.primitive = closestPrimitive;
+	return true;
+}
+
+//! Visits children in whatever order they come, since any hit ends the search
+bool BVH::Occluded(const Ray& ray) const {
+	if (wideNodes.IsEmpty()) return false;
+	assert(!HasMotion());
+
+	WideBVHRay wideRay(ray);
+	WideBVHEntry todo[WideStackSize];
+	unsigned todoOffset = 0, nodeNum = 0;
+	while (true) {
+		const WideBVHNode& node = wideNodes[nodeNum];
+		float tNear[WideBVHNode::Width];
+		int hits = IntersectChildren(node, wideRay, ray.maxt, tNear);
+		for (unsigned i = 0; hits; i++, hits >>= 1) {
+			if (!(hits & 1) || IsEmptySlot(node, i)) continue;
+			if (node.nPrimitives[i] == 0) {
+				assert(todoOffset < sizeof(todo) / sizeof(todo[0]));
+				todo[todoOffset++].child = node.child[i];
+				continue;
+			}
+			float closest = ray.maxt, b1, b2;
+			unsigned index;
+			if (IntersectLeaf<true>(ray, node.child[i], node.nPrimitives[i], node.kind[i], closest, b1, b2, index))
+				return true;
+		}
+		if (todoOffset == 0) return false;
+		nodeNum = todo[--todoOffset].child;
+	}
+}
+
+//! Interval bounds on the origins and reciprocal directions of a packet
+//! Only usable for culling when every direction component has the same sign across the packet
+struct PacketFrustum {
+	PacketFrustum(const RayPacket& packet) {
+		coherent = true;
+		minT = INFINITY;
+		maxT = -INFINITY;
+		const float* o[3] = { packet.ox, packet.oy, packet.oz };
+		const float* inv[3] = { packet.invdx, packet.invdy, packet.invdz };
+		for (unsigned a = 0; a < 3; a++) {
+			oMin[a] = iMin[a] = INFINITY;
+			oMax[a] = iMax[a] = -INFINITY;
+			for (unsigned i = 0; i < packet.size; i++) {
+				oMin[a] = std::min(oMin[a], o[a][i]);
+				oMax[a] = std::max(oMax[a], o[a][i]);
+				iMin[a] = std::min(iMin[a], inv[a][i]);
+				iMax[a] = std::max(iMax[a], inv[a][i]);
+			}
+			if (!(iMin[a] > 0.f || iMax[a] < 0.f) || iMin[a] < -INFINITY || iMax[a] > INFINITY)
+				coherent = false;
+		}
+		for (unsigned i = 0; i < packet.size; i++)
+			minT = std::min(minT, packet.mint[i]);
+	}
+
+	//! Returns true if no ray of the packet can pass through the box before maxT
+	bool Misses(const BBox& b, float maxT) const {
+		if (!coherent) return false;
+		float tNear = minT, tFar = maxT;
+		for (unsigned a = 0; a < 3; a++) {
+			float nearPlane = iMin[a] > 0.f ? b.pMin[a] : b.pMax[a];
+			float farPlane = iMin[a] > 0.f ? b.pMax[a] : b.pMin[a];
+			tNear = std::max(tNear, IntervalMin(nearPlane, a));
+			tFar = std::min(tFar, IntervalMax(farPlane, a) * 1.00000024f);
+		}
+		return tNear > tFar;
+	}
+
+	//! Smallest value of (plane - o) * inv over the packet
+	float IntervalMin(float plane, unsigned a) const {
+		float d0 = plane - oMax[a], d1 = plane - oMin[a];
+		return std::min(std::min(d0 * iMin[a], d0 * iMax[a]), std::min(d1 * iMin[a], d1 * iMax[a]));
+	}
+
+	//! Largest value of (plane - o) * inv over the packet
+	float IntervalMax(float plane, unsigned a) const {
+		float d0 = plane - oMax[a], d1 = plane - oMin[a];
+		return std::max(std::max(d0 * iMin[a], d0 * iMax[a]), std::max(d1 * iMin[a], d1 * iMax[a]));
+	}
+
+	float oMin[3], oMax[3], iMin[3], iMax[3];
+	float minT, maxT;
+	bool coherent;
+};
+
+//! Slab test of every lane in mask against the box, returns the lanes that pass through it
+static unsigned IntersectPacketBox(const BBox& b, const RayPacket& packet, unsigned mask) {
+	const vfloat minX(b.pMin.x), minY(b.pMin.y), minZ(b.pMin.z);
+	const vfloat maxX(b.pMax.x), maxY(b.pMax.y), maxZ(b.pMax.z);
+	const vfloat robust(1.00000024f);
+	unsigned hits = 0;
+	for (unsigned i = 0; i < RayPacket::MaxSize; i += SIMD_WIDTH) {
+		int active = (mask >> i) & SIMDLaneBits();
+		if (!active) continue;
+
+		vfloat ox = vfloat::Load(&packet.ox[i]), oy = vfloat::Load(&packet.oy[i]), oz = vfloat::Load(&packet.oz[i]);
+		vfloat ix = vfloat::Load(&packet.invdx[i]), iy = vfloat::Load(&packet.invdy[i]), iz = vfloat::Load(&packet.invdz[i]);
+		vfloat tx0 = (minX - ox) * ix, tx1 = (maxX - ox) * ix;
+		vfloat ty0 = (minY - oy) * iy, ty1 = (maxY - oy) * iy;
+		vfloat tz0 = (minZ - oz) * iz, tz1 = (maxZ - oz) * iz;
+		vfloat tNear = Max(Max(Min(tx0, tx1), Min(ty0, ty1)), Max(Min(tz0, tz1), vfloat::Load(&packet.mint[i])));
+		vfloat tFar = Min(Min(Max(tx0, tx1), Max(ty0, ty1)), Max(tz0, tz1)) * robust;
+		tFar = Min(tFar, vfloat::Load(&packet.t[i]));
+		hits |= (unsigned)((tNear <= tFar).Bits() & active) << i;
+	}
+	return hits;
+}
+
+//! Finds the closest shape hit by every ray of the packet
+//! Nodes are culled for the whole packet at once when the rays are coherent enough
+void BVH::IntersectPacket(RayPacket& packet) const {
+	if (nodes.empty() || packet.size == 0) return;
+	assert(!HasMotion());
+	packet.Pad();
+
+	PacketFrustum frustum(packet);
+	unsigned dirIsNeg[3] = { packet.dx[0] < 0.f, packet.dy[0] < 0.f, packet.dz[0] < 0.f };
+	unsigned valid = packet.ValidMask();
+	float tHit[RayPacket::MaxSize];
+	float b1Hit[RayPacket::MaxSize], b2Hit[RayPacket::MaxSize];
+
+	unsigned todoOffset = 0, nodeNum = 0;
+	unsigned todo[StackSize];
+	while (true) {
+		const LinearBVHNode& node = nodes[nodeNum];
+
+		// Farthest distance any ray of the packet is still interested in
+		float maxT = 0.f;
+		for (unsigned i = 0; i < packet.size; i++)
+			maxT = std::max(maxT, packet.t[i]);
+
+		unsigned mask = 0;
+		if (!frustum.Misses(node.bounds, maxT))
+			mask = IntersectPacketBox(node.bounds, packet, valid);
+
+		if (mask) {
+			if (node.nPrimitives > 0) {
+				// The SoA sphere kernel has no barycentric coordinates, its hits get zeros as in IntersectLeaf
+				bool barycentrics = node.kind != SpherePrimitive;
+				for (unsigned i = 0; i < node.nPrimitives; i++) {
+					unsigned index = node.primitivesOffset + i;
+					unsigned hits;
+					switch (node.kind) {
+					case SpherePrimitive:
+						hits = spheres.IntersectPacket(index - kindStart[SpherePrimitive], packet, mask, tHit);
+						break;
+					case TrianglePrimitive:
+						hits = triangles.IntersectPacket(index - kindStart[TrianglePrimitive], packet, mask, tHit, b1Hit, b2Hit);
+						break;
+					default:
+						hits = primitives[index]->IntersectPacket(packet, mask, tHit, b1Hit, b2Hit);
+						break;
+					}
+					for (unsigned j = 0; hits; j++, hits >>= 1) {
+						if (hits & 1) {
+							packet.t[j] = tHit[j];
+							packet.b1[j] = barycentrics ? b1Hit[j] : 0.f;
+							packet.b2[j] = barycentrics ? b2Hit[j] : 0.f;
+							packet.shape[j] = primitives[index];
+							packet.primitive[j] = index;
+						}
+					}
+				}
+				if (todoOffset == 0) break;
+				nodeNum = todo[--todoOffset];
+			}
+			else {
+				if (dirIsNeg[node.axis]) {
+					todo[todoOffset++] = nodeNum + 1;
+					nodeNum = node.secondChildOffset;
+				}
+				else {
+					todo[todoOffset++] = node.secondChildOffset;
+					nodeNum = nodeNum + 1;
+				}
+			}
+		}
+		else {
+			if (todoOffset == 0) break;
+			nodeNum = todo[--todoOffset];
+		}
+	}
+}
\ No newline at end of file
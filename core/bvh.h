@@ -0,0 +1,171 @@
+#pragma once
+
+#include "geometry.h"
+#include "shape.h"
+#include "raypacket.h"
+#include "spheresoa.h"
+#include "trianglesoa.h"
+#include "alignedarray.h"
+#include <vector>
+
+struct BVHBuildNode;
+struct BVHPrimitiveInfo;
+
+//! Kinds of shapes a leaf can hold, every leaf holds a single kind
+//! The primitives of a BVH are ordered by kind, spheres and triangles are intersected in SIMD batches from arrays of their own
+//! and only other shapes through Shape::Intersect
+enum PrimitiveKind { SpherePrimitive, TrianglePrimitive, OtherPrimitive, PrimitiveKinds };
+
+//! A node of the flattened BVH, laid out in depth-first order
+//! Interior nodes store the offset of their second child, the first child directly follows
+struct LinearBVHNode {
+	BBox bounds;
+	union {
+		unsigned primitivesOffset; // Leaf
+		unsigned secondChildOffset; // Interior
+	};
+	unsigned short nPrimitives; // 0 for interior nodes
+	unsigned char axis; // Split axis of interior nodes
+	unsigned char kind; // PrimitiveKind of the shapes of a leaf
+};
+
+//! A node of the 8-wide BVH that the binary one is collapsed into for single rays
+//! Child bounds are stored as bytes on a grid over the node, rounded outwards, so that a node fills two cache lines
+//! Unused slots are interior children without bounds that refer to node 0, which is never a child
+struct WideBVHNode {
+	enum { Width = 8 };
+
+	float origin[3]; // Lower corner of the node
+	float scale[3]; // Size of a grid step along each axis
+	unsigned char bounds[2][3][Width]; // Lower and upper child bounds in grid steps from origin, per axis
+	unsigned child[Width]; // Node of interior children, first primitive of leaves
+	unsigned short nPrimitives[Width]; // 0 for interior children
+	unsigned char kind[Width]; // PrimitiveKind of the shapes of leaves
+};
+
+static_assert(sizeof(WideBVHNode) == 2 * AlignedArray<WideBVHNode>::Alignment, "A wide BVH node should fill two cache lines");
+
+//! The arrays of a BVH that rays read as they are, so that they can be stored and used in place again, see BVH::GetArrays
+struct BVHArrays {
+	BVHArrays() : wideNodes(NULL), nWideNodes(0), sphereArraySize(0), triangleArraySize(0) {
+		for (unsigned i = 0; i < SphereSoA::Arrays; i++)
+			spheres[i] = NULL;
+		for (unsigned i = 0; i < TriangleSoA::Arrays; i++)
+			triangles[i] = NULL;
+	}
+
+	const WideBVHNode* wideNodes;
+	unsigned nWideNodes;
+	const float* spheres[SphereSoA::Arrays]; // See SphereSoA::GetArray
+	unsigned sphereArraySize;
+	const float* triangles[TriangleSoA::Arrays]; // See TriangleSoA::GetArray
+	unsigned triangleArraySize;
+};
+
+//! Bounding volume hierarchy over shapes, built with the surface area heuristic
+//! Built as a binary tree, which single rays traverse collapsed into 8-wide nodes
+//! Spheres and triangles are copied into compact arrays of their own in leaf order, so leaves test them without virtual calls
+class BVH {
+public:
+	//! Entries of the fixed stacks that the binary and the wide nodes are traversed with
+	//! The binary stack holds an entry per interior node above the current one, so no interior node may lie deeper than StackSize - 1
+	//! The wide stack holds up to Width - 1 entries per wide node above the current one, plus the Width children of the current one
+	enum { StackSize = 64, WideStackSize = 256 };
+
+	BVH() : maxPrimsInNode(8) {
+		for (unsigned i = 0; i <= PrimitiveKinds; i++)
+			kindStart[i] = 0;
+	}
+
+	//! With motion the bounds of every node are kept for both ends of the shutter interval, see Traverse
+	void Build(const std::vector<Shape*>& shapes, bool motion = false);
+	//! Recomputes the bounds of every node after shapes moved, keeping the tree as it is
+	//! Far cheaper than building, but the tree gets worse the further the shapes move from where they were built
+	void Refit();
+	//! Takes over a hierarchy built earlier, as returned by GetNodes, GetPrimitives and GetArrays
+	//! nodes is swapped in, primitives are the same shapes in the order they had then
+	//! Every leaf has to hold shapes of the kind it says and primitives have to be ordered by kind, see GetKind
+	//! The arrays are borrowed and have to stay until the BVH is built again, refitted or destroyed
+	void Restore(std::vector<LinearBVHNode>& nodes, const std::vector<Shape*>& primitives, const BVHArrays& arrays);
+	//! Traverses the wide nodes, which only exist without motion
+	//! Only sets t, b1, b2, shape and primitive of hit, and only if it finds a hit closer than ray.maxt
+	bool Intersect(const Ray& ray, Hit& hit) const;
+	//! Whether any shape lies along the ray closer than ray.maxt, stops at the first one it finds
+	bool Occluded(const Ray& ray) const;
+	void IntersectPacket(RayPacket& packet) const;
+
+	//! Visits the leaves the ray enters before tMax, near child first
+	//! leaf(first, count) is called with the range of primitives of each leaf and may lower tMax on a hit
+	//! It returns true to end the traversal there
+	//! With motion, the ray is tested against the bounds of every node interpolated to ray.time
+	template <typename LeafFunc>
+	void Traverse(const Ray& ray, const float& tMax, const LeafFunc& leaf) const;
+
+	BBox GetBounds() const { return nodes.empty() ? BBox() : nodes[0].bounds; }
+	bool IsBuilt() const { return !nodes.empty(); }
+	//! Only Traverse handles a hierarchy built with motion
+	bool HasMotion() const { return !endBounds.empty(); }
+	const std::vector<LinearBVHNode>& GetNodes() const { return nodes; }
+	const std::vector<Shape*>& GetPrimitives() const { return primitives; }
+	//! Kind of leaf a shape goes into, also for checking a hierarchy before it is restored
+	static PrimitiveKind GetKind(const Shape* shape);
+	unsigned GetWideNodeCount() const { return wideNodes.GetSize(); }
+	//! Only valid until the BVH changes
+	void GetArrays(BVHArrays& arrays) const;
+
+private:
+	// orderedPrims is an array with a list per PrimitiveKind
+	BVHBuildNode* RecursiveBuild(const std::vector<Shape*>& shapes, std::vector<BVHPrimitiveInfo>& buildData, unsigned start, unsigned end,
+		unsigned* totalNodes, std::vector<Shape*>* orderedPrims);
+	void MakeLeaf(BVHBuildNode* node, const std::vector<Shape*>& shapes, std::vector<BVHPrimitiveInfo>& buildData,
+		unsigned start, unsigned end, const BBox& bounds, unsigned* totalNodes, std::vector<Shape*>* orderedPrims);
+	unsigned Flatten(BVHBuildNode* node, unsigned* offset);
+	void FreeBuildTree(BVHBuildNode* node);
+	void FillPrimitiveArrays();
+	template <bool AnyHit>
+	bool IntersectLeaf(const Ray& ray, unsigned first, unsigned nPrimitives, unsigned kind,
+		float& closest, float& b1, float& b2, unsigned& index) const;
+	void Collapse();
+	unsigned CollapseNode(unsigned root, std::vector<WideBVHNode>& wide) const;
+
+	enum { MaxLeafPrimitives = 65535 }; // Most shapes that LinearBVHNode and WideBVHNode can count in a leaf
+	unsigned maxPrimsInNode;
+	std::vector<Shape*> primitives; // Shapes by kind, ordered so that every leaf references a contiguous range
+	unsigned kindStart[PrimitiveKinds + 1]; // Index in primitives of the first shape of every kind, and of the end
+	std::vector<LinearBVHNode> nodes; // Their bounds are those at time 0 with motion
+	std::vector<BBox> endBounds; // Parallel to nodes, bounds at time 1, empty without motion
+	AlignedArray<WideBVHNode> wideNodes; // Collapsed from nodes, for Intersect, empty with motion
+	SphereSoA spheres; // Parallel to the spheres among primitives
+	TriangleSoA triangles; // Parallel to the triangles among primitives
+};
+
+template <typename LeafFunc>
+void BVH::Traverse(const Ray& ray, const float& tMax, const LeafFunc& leaf) const {
+	if (nodes.empty()) return;
+	Vector invDir(1.f / ray.d.x, 1.f / ray.d.y, 1.f / ray.d.z);
+	unsigned dirIsNeg[3] = { invDir.x < 0.f, invDir.y < 0.f, invDir.z < 0.f };
+	unsigned todoOffset = 0, nodeNum = 0;
+	unsigned todo[StackSize];
+	while (true) {
+		const LinearBVHNode& node = nodes[nodeNum];
+		bool enter = endBounds.empty() ? node.bounds.IntersectP(ray, invDir, dirIsNeg, tMax) :
+			Lerp(ray.time, node.bounds, endBounds[nodeNum]).IntersectP(ray, invDir, dirIsNeg, tMax);
+		if (enter) {
+			if (node.nPrimitives > 0) {
+				if (leaf(node.primitivesOffset, (unsigned)node.nPrimitives)) return;
+			}
+			else if (dirIsNeg[node.axis]) {
+				todo[todoOffset++] = nodeNum + 1;
+				nodeNum = node.secondChildOffset;
+				continue;
+			}
+			else {
+				todo[todoOffset++] = node.secondChildOffset;
+				nodeNum = nodeNum + 1;
+				continue;
+			}
+		}
+		if (todoOffset == 0) break;
+		nodeNum = todo[--todoOffset];
+	}
+}
\ No newline at end of file
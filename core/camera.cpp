@@ -1,57 +1,81 @@
-#include "camera.h"
-
-Ray Camera::GetRay(unsigned x, unsigned y) {
-	assert(x <= film.GetWidth() && y <= film.GetHeight());
-	filmCenter = position + dfilm * direction;
-	float dx = (x - midx) * 0.01f;
-	float dy = (y - midy) * 0.01f;
-	Point p(filmCenter + dx * right + dy * -up);
-	return Ray(position, p - position, 0.000001f);
-}
-
-Ray Camera::GetJitteredRay(unsigned x, unsigned y) {
-	assert(x <= film.GetWidth() && y <= film.GetHeight());
-	filmCenter = position + dfilm * direction;
-	float dx = (x - midx) * 0.01f + urd(mt) * 0.01f;
-	float dy = (y - midy) * 0.01f + urd(mt) * 0.01f;	
-	Point p(filmCenter + dx * right + dy * -up);
-	return Ray(position, p - position, 0.000001f);
-}
-
-Ray Camera::GetJitteredSubRay(unsigned x, unsigned y, int subx, int suby) {
-	assert(x <= film.GetWidth() && y <= film.GetHeight());
-	filmCenter = position + dfilm * direction;
-	float dx = (x - midx) * 0.01f;
-	float dy = (y - midy) * 0.01f;
-
-	float minx = (float)(subx - 1) * 0.005f + dx;
-	float maxx = (float)(subx) * 0.005f + dx;
-	float miny = (float)(suby - 1) * 0.005f + dy;
-	float maxy = (float)(suby) * 0.005f + dy;
-
-	dx = minx + (float)urd(mt) * (maxx - minx);
-	dy = miny + (float)urd(mt) * (maxy - miny);
-
-	Point p(filmCenter + dx * right + dy * -up);
-	return Ray(position, p - position, 0.000001f);
-}
-
-void Camera::MoveLeft(float d) {
-	Vector down(0.f, -1.f, 0.f);
-	Vector left(Cross(down, direction));
-	position += d * left;
-}
-
-void Camera::MoveRight(float d) {
-	Vector down(0.f, -1.f, 0.f);
-	Vector right(Cross(direction, down));
-	position += d * right;
-}
-
-void Camera::MoveForward(float d) {
-	position += d * direction;
-}
-
-void Camera::MoveBackward(float d) {
-	position -= d * direction;
+#include "camera.h"
+
+Ray CameraView::GetRay(unsigned x, unsigned y) const {
+	assert(x <= 2.f * midx && y <= 2.f * midy);
+	Point filmCenter = position + dfilm * direction;
+	float dx = (x - midx) * 0.01f;
+	float dy = (y - midy) * 0.01f;
+	Point p(filmCenter + dx * right + dy * -up);
+	return Ray(position, p - position, 0.000001f);
+}
+
+//! u1 and u2 in [0, 1) place the ray within the pixel
+Ray CameraView::GetJitteredRay(unsigned x, unsigned y, float u1, float u2) const {
+	assert(x <= 2.f * midx && y <= 2.f * midy);
+	Point filmCenter = position + dfilm * direction;
+	float dx = (x - midx) * 0.01f + u1 * 0.01f;
+	float dy = (y - midy) * 0.01f + u2 * 0.01f;
+	Point p(filmCenter + dx * right + dy * -up);
+	return Ray(position, p - position, 0.000001f);
+}
+
+//! Inverse of GetJitteredRay, scales the offset of p along the camera axes onto the film
+bool CameraView::Project(const Point& p, float& x, float& y) const {
+	Vector d = p - position;
+	float z = Dot(d, direction);
+	if (z <= 0.f) return false;
+	float scale = dfilm / z;
+	x = midx + Dot(d, right) * scale * 100.f;
+	y = midy - Dot(d, up) * scale * 100.f;
+	return true;
+}
+
+void Camera::SetResolution(unsigned filmWidth, unsigned filmHeight) {
+	film.Resize(filmWidth, filmHeight);
+	dfilm = (float)(filmWidth)/80.f;
+	midx = (float)(filmWidth)/2.f;
+	midy = (float)(filmHeight)/2.f;
+}
+
+void Camera::SetMotion(const CameraView& end) {
+	this->end = end;
+	moving = true;
+}
+
+//! The axes are interpolated and normalized again, which is close enough for the small steps within a shutter interval
+Ray Camera::GenerateRay(unsigned x, unsigned y, float u1, float u2, float time) const {
+	Ray ray;
+	if (moving && time > 0.f) {
+		CameraView view(*this);
+		view.position = Lerp(time, position, end.position);
+		view.direction = Normalize(Lerp(time, direction, end.direction));
+		view.up = Normalize(Lerp(time, up, end.up));
+		view.right = Normalize(Lerp(time, right, end.right));
+		ray = view.GetJitteredRay(x, y, u1, u2);
+	}
+	else {
+		ray = GetJitteredRay(x, y, u1, u2);
+	}
+	ray.time = time;
+	return ray;
+}
+
+void CameraView::MoveLeft(float d) {
+	Vector down(0.f, -1.f, 0.f);
+	Vector left(Cross(down, direction));
+	position += d * left;
+}
+
+void CameraView::MoveRight(float d) {
+	Vector down(0.f, -1.f, 0.f);
+	Vector right(Cross(direction, down));
+	position += d * right;
+}
+
+void CameraView::MoveForward(float d) {
+	position += d * direction;
+}
+
+void CameraView::MoveBackward(float d) {
+	position -= d * direction;
 }
\ No newline at end of file
@@ -1,37 +1,55 @@
-#pragma once
-
-#include "geometry.h"
-#include "film.h"
-#include <ctime>
-#include <random>
-
-//! A camera from which we can view the world
-class Camera {
-public:
-	Camera() : dfilm(5.f), film(400, 400),
-		up(Vector(0.f, 1.f, 0.f)), right(Vector(1.f, 0.f, 0.f)),
-		midx(200.f), midy(200.f), mt((unsigned)time(0)) {}
-	Camera(unsigned filmWidth, unsigned filmHeight) : dfilm((float)(filmWidth)/80.f), film(filmWidth, filmHeight),
-		up(Vector(0.f, 1.f, 0.f)), right(Vector(1.f, 0.f, 0.f)),
-		midx((float)(filmWidth)/2.f), midy((float)(filmHeight)/2.f), mt((unsigned)time(0)) {}
-	Point position;
-	Vector direction;
-	Film film;
-	Vector up, right;
-
-	Ray GetRay(unsigned x, unsigned y);
-	Ray GetJitteredRay(unsigned x, unsigned y);
-	Ray GetJitteredSubRay(unsigned x, unsigned y, int subx, int suby);
-
-	void MoveLeft(float d);
-	void MoveRight(float d);
-	void MoveForward(float d);
-	void MoveBackward(float d);
-
-private:
-	std::uniform_real_distribution<> urd;
-	std::mt19937 mt;
-	float dfilm; // Distance pinhole and film
-	float midx, midy;
-	Point filmCenter;
+#pragma once
+
+#include "geometry.h"
+#include "film.h"
+
+//! Where a camera is and how it maps film positions to rays, without the film itself
+//! Cheap to copy, so a previous view can be kept around
+class CameraView {
+public:
+	CameraView() : up(Vector(0.f, 1.f, 0.f)), right(Vector(1.f, 0.f, 0.f)),
+		dfilm(5.f), midx(200.f), midy(200.f) {}
+	CameraView(unsigned filmWidth, unsigned filmHeight) : up(Vector(0.f, 1.f, 0.f)), right(Vector(1.f, 0.f, 0.f)),
+		dfilm((float)(filmWidth)/80.f), midx((float)(filmWidth)/2.f), midy((float)(filmHeight)/2.f) {}
+	Point position;
+	Vector direction;
+	Vector up, right;
+
+	Ray GetRay(unsigned x, unsigned y) const;
+	Ray GetJitteredRay(unsigned x, unsigned y, float u1, float u2) const;
+	//! Position on the film that p projects to, in pixels, so pixel (x, y) covers [x, x + 1) x [y, y + 1)
+	//! Returns false if p is not in front of the camera
+	bool Project(const Point& p, float& x, float& y) const;
+
+	void MoveLeft(float d);
+	void MoveRight(float d);
+	void MoveForward(float d);
+	void MoveBackward(float d);
+
+protected:
+	float dfilm; // Distance pinhole and film
+	float midx, midy;
+};
+
+//! A camera from which we can view the world
+class Camera : public CameraView {
+public:
+	Camera() : CameraView(400, 400), film(400, 400), moving(false) {}
+	Camera(unsigned filmWidth, unsigned filmHeight) : CameraView(filmWidth, filmHeight), film(filmWidth, filmHeight), moving(false) {}
+	Film film;
+
+	//! Moves the camera from where it is at time 0 to end at time 1 of the shutter interval, for motion blur
+	//! Only the position and axes of end are used
+	void SetMotion(const CameraView& end);
+	//! Keeps the camera where it is during the whole shutter interval
+	void ClearMotion() { moving = false; }
+	//! Jittered ray at time within the shutter interval, from where the camera is at that time
+	Ray GenerateRay(unsigned x, unsigned y, float u1, float u2, float time) const;
+
+	//! Resizes the film, keeping the field of view as if the camera had been created with these dimensions
+	void SetResolution(unsigned filmWidth, unsigned filmHeight);
+
+private:
+	bool moving;
+	CameraView end;
 };
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "denoiser.h"
+#include "simd.h"
+#include <algorithm>
+#include <cstdlib>
+
+// Filter parameters
+static const float sigmaLuminance = 1.f; // Luminance differences in units of the standard deviation
+static const float sigmaDepth = 0.02f; // Relative depth change allowed per pixel of distance
+static const float epsilon = 1e-4f;
+
+Denoiser::Denoiser(unsigned nThreads) : scheduler(nThreads), iterations(5), width(0), height(0), pad(0), stride(0), rows(0) {}
+
+//! Close to exp(-x) for small x and exactly 0 from 16 on, which is all the weights need
+static inline vfloat ExpNeg(const vfloat& x) {
+	vfloat p = Max(vfloat(0.f), vfloat(1.f) - x * vfloat(1.f / 16.f));
+	p = p * p;
+	p = p * p;
+	p = p * p;
+	return p * p;
+}
+
+//! Albedo that the illumination is divided by, black surfaces are left alone
+static Color Demodulation(const Color& albedo) {
+	return Color(albedo.r > 0.01f ? albedo.r : 1.f, albedo.g > 0.01f ? albedo.g : 1.f, albedo.b > 0.01f ? albedo.b : 1.f);
+}
+
+void Denoiser::Denoise(const FilmImage& image, std::vector<Color>& out) {
+	width = image.width;
+	height = image.height;
+	pad = 2u << (iterations > 0 ? iterations - 1 : 0);
+	stride = (width + 2 * pad + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH + SIMD_WIDTH;
+	rows = height + 2 * pad;
+	for (unsigned k = 0; k < nColorPlanes; k++) {
+		color[0][k].assign(stride * rows, 0.f);
+		color[1][k].assign(stride * rows, 0.f);
+	}
+	for (unsigned k = 0; k < nFeaturePlanes; k++)
+		features[k].assign(stride * rows, 0.f);
+
+	for (unsigned y = 0; y < height; y++) {
+		for (unsigned x = 0; x < width; x++) {
+			unsigned i = y * width + x;
+			unsigned p = (y + pad) * stride + x + pad;
+			Color a = Demodulation(image.albedo[i]);
+			color[0][Red][p] = image.color[i].r / a.r;
+			color[0][Green][p] = image.color[i].g / a.g;
+			color[0][Blue][p] = image.color[i].b / a.b;
+			float la = a.Luminance();
+			color[0][Variance][p] = image.variance[i] / (la * la);
+
+			// Pixels that missed everything all get the same normal, the depth keeps them apart from surfaces
+			Vector n(image.normal[i].x, image.normal[i].y, image.normal[i].z);
+			n = n.LengthSquared() > 0.f ? Normalize(n) : Vector(0.f, 0.f, 1.f);
+			features[NormalX][p] = n.x;
+			features[NormalY][p] = n.y;
+			features[NormalZ][p] = n.z;
+			features[Depth][p] = image.depth[i];
+			features[Valid][p] = 1.f;
+		}
+	}
+
+	// Bands of rows are filtered in parallel, every iteration reads one buffer and writes the other
+	const unsigned bandHeight = 8;
+	unsigned nBands = (height + bandHeight - 1) / bandHeight;
+	unsigned src = 0;
+	for (unsigned it = 0; it < iterations; it++) {
+		unsigned step = 1u << it;
+		scheduler.Run(nBands, [&](unsigned band, unsigned) {
+			FilterRows(band * bandHeight, std::min((band + 1) * bandHeight, height), step, src);
+		});
+		src = 1 - src;
+	}
+
+	out.resize(width * height);
+	for (unsigned y = 0; y < height; y++) {
+		for (unsigned x = 0; x < width; x++) {
+			unsigned i = y * width + x;
+			unsigned p = (y + pad) * stride + x + pad;
+			Color a = Demodulation(image.albedo[i]);
+			out[i] = Color(color[src][Red][p] * a.r, color[src][Green][p] * a.g, color[src][Blue][p] * a.b);
+		}
+	}
+}
+
+//! One a-trous iteration over rows [y0, y1), SIMD_WIDTH pixels of a row at a time
+void Denoiser::FilterRows(unsigned y0, unsigned y1, unsigned step, unsigned src) {
+	static const float kernel[5] = { 1.f / 16.f, 1.f / 4.f, 3.f / 8.f, 1.f / 4.f, 1.f / 16.f };
+	const float* inR = &color[src][Red][0];
+	const float* inG = &color[src][Green][0];
+	const float* inB = &color[src][Blue][0];
+	const float* inV = &color[src][Variance][0];
+	float* outR = &color[1 - src][Red][0];
+	float* outG = &color[1 - src][Green][0];
+	float* outB = &color[1 - src][Blue][0];
+	float* outV = &color[1 - src][Variance][0];
+	const float* nx = &features[NormalX][0];
+	const float* ny = &features[NormalY][0];
+	const float* nz = &features[NormalZ][0];
+	const float* depth = &features[Depth][0];
+	const float* valid = &features[Valid][0];
+	const vfloat lumR(0.2126f), lumG(0.7152f), lumB(0.0722f);
+
+	for (unsigned y = y0; y < y1; y++) {
+		for (unsigned x = 0; x < width; x += SIMD_WIDTH) {
+			unsigned p = (y + pad) * stride + x + pad;
+			vfloat pr = vfloat::Load(inR + p), pg = vfloat::Load(inG + p), pb = vfloat::Load(inB + p);
+			vfloat pl = lumR * pr + lumG * pg + lumB * pb;
+			vfloat pnx = vfloat::Load(nx + p), pny = vfloat::Load(ny + p), pnz = vfloat::Load(nz + p);
+			vfloat pz = vfloat::Load(depth + p);
+			vfloat lumScale = vfloat(1.f) / (vfloat(sigmaLuminance) * Sqrt(vfloat::Load(inV + p)) + vfloat(epsilon));
+
+			vfloat sumR(0.f), sumG(0.f), sumB(0.f), sumV(0.f), sumW(0.f);
+			for (int dy = -2; dy <= 2; dy++) {
+				for (int dx = -2; dx <= 2; dx++) {
+					unsigned q = (unsigned)((int)p + (dy * (int)stride + dx) * (int)step);
+					vfloat qr = vfloat::Load(inR + q), qg = vfloat::Load(inG + q), qb = vfloat::Load(inB + q);
+					vfloat ql = lumR * qr + lumG * qg + lumB * qb;
+					vfloat qz = vfloat::Load(depth + q);
+
+					float distance = (float)(step * std::max(std::abs(dx), std::abs(dy)));
+					vfloat depthScale = vfloat(sigmaDepth * distance) * Max(pz, qz) + vfloat(epsilon);
+					vfloat e = Abs(pl - ql) * lumScale + Abs(pz - qz) / depthScale;
+
+					// Normal weight is the cosine between the normals to the power 32
+					vfloat c = Max(vfloat(0.f), pnx * vfloat::Load(nx + q) + pny * vfloat::Load(ny + q) + pnz * vfloat::Load(nz + q));
+					c = c * c;
+					c = c * c;
+					c = c * c;
+					c = c * c;
+					c = c * c;
+
+					vfloat w = vfloat(kernel[dx + 2] * kernel[dy + 2]) * ExpNeg(e) * c * vfloat::Load(valid + q);
+					sumR = sumR + w * qr;
+					sumG = sumG + w * qg;
+					sumB = sumB + w * qb;
+					sumV = sumV + w * w * vfloat::Load(inV + q);
+					sumW = sumW + w;
+				}
+			}
+
+			vfloat inv = vfloat(1.f) / Max(sumW, vfloat(1e-10f));
+			(sumR * inv).Store(outR + p);
+			(sumG * inv).Store(outG + p);
+			(sumB * inv).Store(outB + p);
+			(sumV * inv * inv).Store(outV + p);
+		}
+	}
+}
\ No newline at end of file
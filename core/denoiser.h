@@ -0,0 +1,40 @@
+#pragma once
+
+#include "film.h"
+#include "scheduler.h"
+#include <vector>
+
+//! Edge-aware a-trous wavelet filter for noisy renders, in the spirit of SVGF without the temporal part
+//! Each iteration blurs with a 5x5 kernel whose taps are twice as far apart as in the previous one
+//! Taps are weighted down where normals, depth or the luminance (relative to its noise) differ,
+//! so the blur stays within surfaces and keeps their edges
+//! The albedo is divided out before filtering and multiplied back in afterwards, which keeps surface detail
+class Denoiser {
+public:
+	explicit Denoiser(unsigned nThreads);
+
+	//! Number of wavelet iterations, the filter reaches 2^(iterations+1) pixels far
+	void SetIterations(unsigned n) { iterations = n; }
+	unsigned GetIterations() const { return iterations; }
+
+	//! Writes the filtered colors of image to out, which may be image.color itself
+	void Denoise(const FilmImage& image, std::vector<Color>& out);
+
+private:
+	// Not copyable, owns its threads
+	Denoiser(const Denoiser&);
+	Denoiser& operator=(const Denoiser&);
+
+	void FilterRows(unsigned y0, unsigned y1, unsigned step, unsigned src);
+
+	//! Planes of floats, padded on every side so that taps never need bounds checks
+	enum { Red, Green, Blue, Variance, nColorPlanes };
+	enum { NormalX, NormalY, NormalZ, Depth, Valid, nFeaturePlanes };
+
+	Scheduler scheduler;
+	unsigned iterations;
+	unsigned width, height;
+	unsigned pad, stride, rows;
+	std::vector<float> color[2][nColorPlanes]; // Ping-pong buffers of the illumination and its variance
+	std::vector<float> features[nFeaturePlanes];
+};
\ No newline at end of file
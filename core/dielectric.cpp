@@ -0,0 +1,40 @@
+#include "dielectric.h"
+#include <algorithm>
+
+//! Fraction of light reflected at a smooth boundary, cosI is measured on the side of the incoming light
+static float FresnelDielectric(float cosI, float etaI, float etaT) {
+	float sinT = etaI / etaT * sqrtf(std::max(0.f, 1.f - cosI * cosI));
+	if (sinT >= 1.f) return 1.f; // Total internal reflection
+	float cosT = sqrtf(std::max(0.f, 1.f - sinT * sinT));
+	float parallel = (etaT * cosI - etaI * cosT) / (etaT * cosI + etaI * cosT);
+	float perpendicular = (etaI * cosI - etaT * cosT) / (etaI * cosI + etaT * cosT);
+	return 0.5f * (parallel * parallel + perpendicular * perpendicular);
+}
+
+Color Dielectric::Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const {
+	*specular = true;
+	bool entering = wo.z > 0.f;
+	float etaI = entering ? 1.f : eta;
+	float etaT = entering ? eta : 1.f;
+	float cosO = fabsf(wo.z);
+	if (cosO == 0.f) {
+		*pdf = 0.f;
+		return Color();
+	}
+	float reflectance = FresnelDielectric(cosO, etaI, etaT);
+
+	if (u1 < reflectance) {
+		*wi = Vector(-wo.x, -wo.y, wo.z);
+		*pdf = reflectance;
+		return color * (reflectance / cosO);
+	}
+
+	// Snell's law, the transmitted direction lies on the other side of the surface
+	float ratio = etaI / etaT;
+	float sin2T = ratio * ratio * std::max(0.f, 1.f - cosO * cosO);
+	float cosT = sqrtf(std::max(0.f, 1.f - sin2T));
+	*wi = Vector(-ratio * wo.x, -ratio * wo.y, entering ? -cosT : cosT);
+	*pdf = 1.f - reflectance;
+	// Radiance is compressed into a smaller solid angle when entering a denser medium
+	return color * ((1.f - reflectance) * ratio * ratio / cosT);
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "material.h"
+
+//! Smooth glass-like surface that both reflects and refracts, in proportions given by the Fresnel equations
+//! The normal of the shape points to the outside
+class Dielectric : public Material {
+public:
+	Dielectric() : color(1.f, 1.f, 1.f), eta(1.5f) {}
+	explicit Dielectric(float eta, const Color& color = Color(1.f, 1.f, 1.f)) : color(color), eta(eta) {}
+
+	Color Eval(const Vector& wo, const Vector& wi) const { return Color(); }
+	//! Picks reflection or refraction with the probability of each
+	Color Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const;
+	float Pdf(const Vector& wo, const Vector& wi) const { return 0.f; }
+	bool IsSpecular() const { return true; }
+	Color GetAlbedo() const { return color; }
+
+	Color color; // Tint applied to every interaction
+	float eta; // Index of refraction of the inside relative to the outside
+};
\ No newline at end of file
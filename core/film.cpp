@@ -0,0 +1,204 @@
+#include "film.h"
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+Film::Film(unsigned width, unsigned height) : width(width), height(height) {
+	SetFilter(BoxFilter());
+	Resize(width, height);
+}
+
+void Film::SetFilter(const Filter& filter) {
+	filterRadius = filter.radius;
+	// Sample every entry at its center
+	for (unsigned y = 0; y < FilterTableSize; y++) {
+		for (unsigned x = 0; x < FilterTableSize; x++) {
+			float dx = ((float)x + 0.5f) * filterRadius / (float)FilterTableSize;
+			float dy = ((float)y + 0.5f) * filterRadius / (float)FilterTableSize;
+			filterTable[y * FilterTableSize + x] = filter.Evaluate(dx, dy);
+		}
+	}
+}
+
+float Film::GetFilterWeight(float dx, float dy) const {
+	float scale = (float)FilterTableSize / filterRadius;
+	unsigned ix = std::min((unsigned)(fabsf(dx) * scale), (unsigned)FilterTableSize - 1);
+	unsigned iy = std::min((unsigned)(fabsf(dy) * scale), (unsigned)FilterTableSize - 1);
+	return filterTable[iy * FilterTableSize + ix];
+}
+
+Color Film::GetPixel(unsigned x, unsigned y) const {
+	unsigned i = y * width + x;
+	return weights[i] != 0.f ? pixels[i] / weights[i] : Color();
+}
+
+float Film::GetVariance(unsigned x, unsigned y) const {
+	unsigned i = y * width + x;
+	unsigned n = counts[i];
+	if (n < 2) return std::numeric_limits<float>::infinity();
+	float mean = luminance[i] / (float)n;
+	float variance = std::max(0.f, luminance2[i] / (float)n - mean * mean) * (float)n / (float)(n - 1);
+	return variance / (float)n;
+}
+
+//! Measured on the unfiltered samples of the pixel, so that it only depends on the pixel itself
+float Film::GetRelativeError(unsigned x, unsigned y) const {
+	unsigned n = GetSampleCount(x, y);
+	if (n < 2) return std::numeric_limits<float>::infinity();
+	float mean = luminance[y * width + x] / (float)n;
+	return sqrtf(GetVariance(x, y)) / std::max(mean, 0.05f);
+}
+
+void Film::Resolve(FilmImage& image) const {
+	unsigned n = width * height;
+	image.width = width;
+	image.height = height;
+	image.color.resize(n);
+	image.albedo.resize(n);
+	image.normal.resize(n);
+	image.depth.resize(n);
+	image.variance.resize(n);
+	image.samples.resize(n);
+	for (unsigned i = 0; i < n; i++) {
+		float scale = counts[i] > 0 ? 1.f / (float)counts[i] : 0.f;
+		image.color[i] = weights[i] != 0.f ? pixels[i] / weights[i] : Color();
+		image.albedo[i] = albedo[i] * scale;
+		image.normal[i] = normals[i] * scale;
+		image.depth[i] = depths[i] * scale;
+		image.variance[i] = counts[i] > 1 ? GetVariance(i % width, i / width) : 0.f;
+		image.samples[i] = counts[i];
+	}
+}
+
+//! The statistics of the owned pixels are only ever written by the tile that owns them, so they need no lock
+//! Only the filtered sums near the borders can overlap with other tiles, those are merged a stripe of rows at a time
+//! under the lock of the stripe, so that tiles in other rows of the film merge at the same time
+void Film::MergeTile(const FilmTile& tile) {
+	assert(tile.film == this);
+	unsigned sw = tile.sx1 - tile.sx0;
+	for (unsigned y = tile.sy0; y < tile.sy1; ) {
+		unsigned stripe = y / LockRows;
+		unsigned stripeEnd = std::min(tile.sy1, (stripe + 1) * LockRows);
+		std::lock_guard<std::mutex> lock(rowLocks[stripe % RowLocks]);
+		for (; y < stripeEnd; y++) {
+			for (unsigned x = tile.sx0; x < tile.sx1; x++) {
+				unsigned i = y * width + x;
+				unsigned j = (y - tile.sy0) * sw + (x - tile.sx0);
+				pixels[i] += tile.pixels[j];
+				weights[i] += tile.weights[j];
+			}
+		}
+	}
+	unsigned w = tile.x1 - tile.x0;
+	for (unsigned y = tile.y0; y < tile.y1; y++) {
+		for (unsigned x = tile.x0; x < tile.x1; x++) {
+			unsigned i = y * width + x;
+			unsigned j = (y - tile.y0) * w + (x - tile.x0);
+			luminance[i] += tile.luminance[j];
+			luminance2[i] += tile.luminance2[j];
+			counts[i] += tile.counts[j];
+			albedo[i] += tile.albedo[j];
+			normals[i] += tile.normals[j];
+			depths[i] += tile.depths[j];
+		}
+	}
+}
+
+//! The luminance moments are rebuilt from the average and its variance, so adaptive sampling sees the history as real samples
+void Film::AddHistory(unsigned x, unsigned y, const Color& color, const PixelFeatures& features, float variance, unsigned n) {
+	assert(n > 0);
+	unsigned i = y * width + x;
+	// With a wide filter a sample counts for more or less than 1 in the weights, use the average of the pixel so far
+	float sampleWeight = counts[i] > 0 && weights[i] > 0.f ? weights[i] / (float)counts[i] : 1.f;
+	float l = color.Luminance();
+	float sampleVariance = variance * (float)n;
+	pixels[i] += color * (sampleWeight * (float)n);
+	weights[i] += sampleWeight * (float)n;
+	luminance[i] += l * (float)n;
+	luminance2[i] += (float)n * l * l + (float)(n - 1) * sampleVariance;
+	albedo[i] += features.albedo * (float)n;
+	normals[i] += features.normal * (float)n;
+	depths[i] += counts[i] > 0 ? depths[i] / (float)counts[i] * (float)n : 0.f;
+	counts[i] += n;
+}
+
+void Film::Clear() {
+	std::fill(pixels.begin(), pixels.end(), Color());
+	std::fill(weights.begin(), weights.end(), 0.f);
+	std::fill(luminance.begin(), luminance.end(), 0.f);
+	std::fill(luminance2.begin(), luminance2.end(), 0.f);
+	std::fill(counts.begin(), counts.end(), 0);
+	std::fill(albedo.begin(), albedo.end(), Color());
+	std::fill(normals.begin(), normals.end(), Normal());
+	std::fill(depths.begin(), depths.end(), 0.f);
+}
+
+void Film::Resize(unsigned w, unsigned h) {
+	width = w;
+	height = h;
+	unsigned n = width * height;
+	pixels.resize(n);
+	weights.resize(n);
+	luminance.resize(n);
+	luminance2.resize(n);
+	counts.resize(n);
+	albedo.resize(n);
+	normals.resize(n);
+	depths.resize(n);
+	Clear();
+}
+
+void FilmTile::Reset(const Film& film, unsigned x0, unsigned y0, unsigned x1, unsigned y1) {
+	this->film = &film;
+	this->x0 = x0;
+	this->y0 = y0;
+	this->x1 = x1;
+	this->y1 = y1;
+	// A sample reaches the pixels whose centers are less than the radius away
+	unsigned border = (unsigned)ceilf(film.GetFilterRadius() - 0.5f);
+	sx0 = x0 > border ? x0 - border : 0;
+	sy0 = y0 > border ? y0 - border : 0;
+	sx1 = std::min(x1 + border, film.GetWidth());
+	sy1 = std::min(y1 + border, film.GetHeight());
+
+	unsigned n = (sx1 - sx0) * (sy1 - sy0);
+	pixels.assign(n, Color());
+	weights.assign(n, 0.f);
+	unsigned owned = (x1 - x0) * (y1 - y0);
+	luminance.assign(owned, 0.f);
+	luminance2.assign(owned, 0.f);
+	counts.assign(owned, 0);
+	albedo.assign(owned, Color());
+	normals.assign(owned, Normal());
+	depths.assign(owned, 0.f);
+}
+
+void FilmTile::AddSample(unsigned x, unsigned y, float u1, float u2, const Color& color, const PixelFeatures& features) {
+	assert(x >= x0 && x < x1 && y >= y0 && y < y1);
+	unsigned i = (y - y0) * (x1 - x0) + (x - x0);
+	float l = color.Luminance();
+	luminance[i] += l;
+	luminance2[i] += l * l;
+	counts[i]++;
+	albedo[i] += features.albedo;
+	normals[i] += features.normal;
+	depths[i] += features.depth;
+
+	// Splat onto every pixel whose center is within the radius
+	// Offsets are taken relative to the center of pixel (x, y), so that they do not lose precision far from the origin
+	float ox = u1 - 0.5f, oy = u2 - 0.5f;
+	float radius = film->GetFilterRadius();
+	int fx0 = std::max((int)x + (int)floorf(ox - radius) + 1, (int)sx0);
+	int fy0 = std::max((int)y + (int)floorf(oy - radius) + 1, (int)sy0);
+	int fx1 = std::min((int)x + (int)floorf(ox + radius), (int)sx1 - 1);
+	int fy1 = std::min((int)y + (int)floorf(oy + radius), (int)sy1 - 1);
+	unsigned sw = sx1 - sx0;
+	for (int fy = fy0; fy <= fy1; fy++) {
+		for (int fx = fx0; fx <= fx1; fx++) {
+			float weight = film->GetFilterWeight((float)(fx - (int)x) - ox, (float)(fy - (int)y) - oy);
+			unsigned j = (fy - sy0) * sw + (fx - sx0);
+			pixels[j] += weight * color;
+			weights[j] += weight;
+		}
+	}
+}
\ No newline at end of file
@@ -1,25 +1,133 @@
-#pragma once
-
-#include "color.h"
-
-//! Represents the film on which light is projected to form an image
-class Film {
-public:
-	Film(unsigned width, unsigned height) : width(width), height(height) {
-		pixels = new Color[width*height];
-	}
-	~Film() {
-		delete pixels;
-	}
-
-	unsigned	GetWidth() const { return width; }
-	unsigned	GetHeight() const { return height; }
-
-	Color		GetPixel(unsigned x, unsigned y) const { return pixels[y * width + x]; }
-	void		SetPixel(unsigned x, unsigned y, const Color& color) { pixels[y * width + x] = color; }
-	void		Clear() { for (unsigned i = 0; i < width*height; i++) pixels[i] = Color(); }
-
-private:
-	unsigned	width, height; // Dimensions of film in pixels
-	Color*		pixels;
+#pragma once
+
+#include "color.h"
+#include "geometry.h"
+#include "filter.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+//! What the camera ray of a sample hit first, the denoiser uses it to tell edges from noise
+struct PixelFeatures {
+	Color albedo;
+	Normal normal;
+	float depth; // Distance to the camera, 0 if nothing was hit
+};
+
+//! Averaged contents of a film, every channel row by row, top row first
+struct FilmImage {
+	FilmImage() : width(0), height(0) {}
+
+	void Swap(FilmImage& other) {
+		std::swap(width, other.width);
+		std::swap(height, other.height);
+		color.swap(other.color);
+		albedo.swap(other.albedo);
+		normal.swap(other.normal);
+		depth.swap(other.depth);
+		variance.swap(other.variance);
+		samples.swap(other.samples);
+	}
+
+	unsigned width, height;
+	std::vector<Color> color;
+	std::vector<Color> albedo;
+	std::vector<Normal> normal; // Not normalized, the average of the normals in the pixel
+	std::vector<float> depth;
+	std::vector<float> variance; // Of the average luminance
+	std::vector<unsigned> samples; // Number of samples in the pixel
+};
+
+class FilmTile;
+
+//! Represents the film on which light is projected to form an image
+//! Samples are splatted with a reconstruction filter onto every pixel within its radius,
+//! each pixel keeps the weighted sum of the samples and the sum of the weights
+//! The statistics that tell how noisy a pixel still is, and the features of the first hits for the denoiser,
+//! are only kept for the pixel a sample lies in and are not filtered
+//! Samples are first gathered in a FilmTile per thread, which is merged into the film in one go
+class Film {
+public:
+	Film(unsigned width, unsigned height);
+
+	unsigned	GetWidth() const { return width; }
+	unsigned	GetHeight() const { return height; }
+
+	//! Changes the reconstruction filter, a box of radius 0.5 by default
+	//! Only call this while nothing renders, the film is not cleared
+	void		SetFilter(const Filter& filter);
+	float		GetFilterRadius() const { return filterRadius; }
+	//! Weight of a sample at offset (dx, dy) from the center of a pixel, looked up in a table of the filter
+	float		GetFilterWeight(float dx, float dy) const;
+
+	//! Weighted average of the samples around the pixel
+	Color		GetPixel(unsigned x, unsigned y) const;
+	unsigned	GetSampleCount(unsigned x, unsigned y) const { return counts[y * width + x]; }
+	//! Variance of the average luminance of the samples in the pixel
+	float		GetVariance(unsigned x, unsigned y) const;
+	//! Standard error of the average luminance of the pixel, relative to that average
+	//! Pixels darker than 0.05 are measured against 0.05, so that black pixels do not need endless samples
+	float		GetRelativeError(unsigned x, unsigned y) const;
+	//! Fills image with the averages of all pixels
+	void		Resolve(FilmImage& image) const;
+
+	//! Adds all samples of the tile, safe to call from several threads at once
+	void		MergeTile(const FilmTile& tile);
+	//! Adds n samples carried over from an earlier image, whose average was color with the given variance of the average luminance
+	//! They count as much as n samples of the pixel itself, the depth in features is ignored and the pixel keeps its own
+	void		AddHistory(unsigned x, unsigned y, const Color& color, const PixelFeatures& features, float variance, unsigned n);
+
+	void		Clear();
+	//! Changes the dimensions, the film is cleared
+	void		Resize(unsigned w, unsigned h);
+
+private:
+	// Not copyable, owns mutexes and copying the buffers by accident would be slow
+	Film(const Film&);
+	Film& operator=(const Film&);
+
+	enum { FilterTableSize = 16 }; // Entries of the filter table along each axis
+	enum { LockRows = 8, RowLocks = 64 }; // Rows of filtered sums guarded by each lock, and number of locks
+
+	unsigned	width, height; // Dimensions of film in pixels
+	std::vector<Color>		pixels; // Weighted sums of the samples
+	std::vector<float>		weights; // Sums of the filter weights
+	std::vector<float>		luminance; // Sums of the luminance of the samples in the pixel
+	std::vector<float>		luminance2; // Sums of the squared luminance of the samples in the pixel
+	std::vector<unsigned>	counts; // Number of samples in the pixel
+	std::vector<Color>		albedo; // Sums of the features of the samples in the pixel
+	std::vector<Normal>		normals;
+	std::vector<float>		depths;
+	float		filterRadius;
+	float		filterTable[FilterTableSize * FilterTableSize]; // Weights over [0, radius) in x and y, filters are symmetric
+	std::mutex	rowLocks[RowLocks]; // Lock i guards the filtered sums of every stripe of LockRows rows whose number is i modulo RowLocks
+};
+
+//! Samples of one tile, gathered without touching the film so that threads never write to the same memory
+//! Covers the pixels of the tile plus a border as wide as the filter radius
+//! Meant to be kept per thread and reset for every tile, so its buffers are reused
+class FilmTile {
+public:
+	FilmTile() : film(NULL) {}
+
+	//! Starts gathering the samples of the pixels in [x0, x1) x [y0, y1) of film
+	void		Reset(const Film& film, unsigned x0, unsigned y0, unsigned x1, unsigned y1);
+
+	//! Adds a sample of pixel (x, y) at offset (u1, u2) in [0, 1) within the pixel
+	void		AddSample(unsigned x, unsigned y, float u1, float u2, const Color& color, const PixelFeatures& features);
+
+private:
+	friend class Film;
+
+	const Film*	film;
+	unsigned	x0, y0, x1, y1; // Pixels owned by the tile
+	unsigned	sx0, sy0, sx1, sy1; // Pixels the filter reaches, clipped to the film
+	std::vector<Color>		pixels; // Over the filter region
+	std::vector<float>		weights;
+	std::vector<float>		luminance; // Over the owned pixels
+	std::vector<float>		luminance2;
+	std::vector<unsigned>	counts;
+	std::vector<Color>		albedo;
+	std::vector<Normal>		normals;
+	std::vector<float>		depths;
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "filter.h"
+#include <algorithm>
+#include <cmath>
+
+float TentFilter::Evaluate(float x, float y) const {
+	return std::max(0.f, radius - fabsf(x)) * std::max(0.f, radius - fabsf(y));
+}
+
+float GaussianFilter::Gaussian(float d) const {
+	return std::max(0.f, expf(-alpha * d * d) - expf(-alpha * radius * radius));
+}
+
+float GaussianFilter::Evaluate(float x, float y) const {
+	return Gaussian(x) * Gaussian(y);
+}
+
+//! x is scaled to [-2, 2], where the cubic is defined
+float MitchellFilter::Mitchell1D(float x) const {
+	x = fabsf(2.f * x / radius);
+	if (x >= 2.f) return 0.f;
+	if (x > 1.f)
+		return ((-b - 6.f * c) * x * x * x + (6.f * b + 30.f * c) * x * x + (-12.f * b - 48.f * c) * x + (8.f * b + 24.f * c)) / 6.f;
+	return ((12.f - 9.f * b - 6.f * c) * x * x * x + (-18.f + 12.f * b + 6.f * c) * x * x + (6.f - 2.f * b)) / 6.f;
+}
+
+float MitchellFilter::Evaluate(float x, float y) const {
+	return Mitchell1D(x) * Mitchell1D(y);
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+//! Pixel reconstruction filter, weighs a sample by its offset from the center of a pixel
+//! The weight is 0 from radius on, in both x and y
+class Filter {
+public:
+	explicit Filter(float radius) : radius(radius) {}
+	virtual ~Filter() {}
+
+	//! Weight of a sample at offset (x, y) from the pixel center, both within (-radius, radius)
+	virtual float Evaluate(float x, float y) const = 0;
+
+	float radius;
+};
+
+//! Every sample only counts for the pixel it lies in, with a radius of 0.5
+class BoxFilter : public Filter {
+public:
+	explicit BoxFilter(float radius = 0.5f) : Filter(radius) {}
+	float Evaluate(float, float) const { return 1.f; }
+};
+
+//! Weight falls off linearly to 0 at the radius
+class TentFilter : public Filter {
+public:
+	explicit TentFilter(float radius = 1.f) : Filter(radius) {}
+	float Evaluate(float x, float y) const;
+};
+
+//! Gaussian that is shifted down to reach 0 at the radius
+class GaussianFilter : public Filter {
+public:
+	explicit GaussianFilter(float radius = 1.5f, float alpha = 2.f) : Filter(radius), alpha(alpha) {}
+	float Evaluate(float x, float y) const;
+
+	float alpha; // Falloff, larger is narrower
+
+private:
+	float Gaussian(float d) const;
+};
+
+//! Mitchell-Netravali cubic, sharper than a Gaussian thanks to its negative lobes
+class MitchellFilter : public Filter {
+public:
+	explicit MitchellFilter(float radius = 2.f, float b = 1.f / 3.f, float c = 1.f / 3.f) : Filter(radius), b(b), c(c) {}
+	float Evaluate(float x, float y) const;
+
+	float b, c;
+
+private:
+	float Mitchell1D(float x) const;
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "glossy.h"
+#include <algorithm>
+
+// Both directions are moved to the upper hemisphere first, which makes the material two sided
+
+float Glossy::GetAlpha() const {
+	// Alpha below this makes the distribution too peaked for single precision
+	return std::max(roughness * roughness, 1e-3f);
+}
+
+//! Density of microfacets with normal h
+float Glossy::D(const Vector& h) const {
+	float alpha2 = GetAlpha() * GetAlpha();
+	float cos2 = h.z * h.z;
+	float d = cos2 * (alpha2 - 1.f) + 1.f;
+	return alpha2 / (PI * d * d);
+}
+
+//! Smith masking for a single direction
+float Glossy::G1(const Vector& w) const {
+	float alpha2 = GetAlpha() * GetAlpha();
+	float cos2 = w.z * w.z;
+	return 2.f / (1.f + sqrtf(1.f + alpha2 * (1.f - cos2) / cos2));
+}
+
+Color Glossy::Eval(const Vector& wo, const Vector& wi) const {
+	if (!SameHemisphere(wo, wi)) return Color();
+	Vector o = wo.z < 0.f ? -wo : wo;
+	Vector i = wo.z < 0.f ? -wi : wi;
+	Vector h = o + i;
+	if (h.LengthSquared() == 0.f) return Color();
+	h = Normalize(h);
+
+	float cosD = std::max(0.f, Dot(i, h));
+	float schlick = powf(1.f - cosD, 5.f);
+	Color fresnel = color + (Color(1.f, 1.f, 1.f) - color) * schlick;
+	return fresnel * (D(h) * G1(o) * G1(i) / (4.f * o.z * i.z));
+}
+
+Color Glossy::Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const {
+	*specular = false;
+	float alpha2 = GetAlpha() * GetAlpha();
+	float cos2 = (1.f - u1) / (1.f + (alpha2 - 1.f) * u1);
+	float cosTheta = sqrtf(cos2);
+	float sinTheta = sqrtf(std::max(0.f, 1.f - cos2));
+	float phi = 2.f * PI * u2;
+	Vector h(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+
+	Vector o = wo.z < 0.f ? -wo : wo;
+	Vector i = -o + 2.f * Dot(o, h) * h;
+	*wi = wo.z < 0.f ? -i : i;
+	*pdf = Pdf(wo, *wi);
+	if (*pdf == 0.f) return Color();
+	return Eval(wo, *wi);
+}
+
+float Glossy::Pdf(const Vector& wo, const Vector& wi) const {
+	if (!SameHemisphere(wo, wi)) return 0.f;
+	Vector o = wo.z < 0.f ? -wo : wo;
+	Vector i = wo.z < 0.f ? -wi : wi;
+	Vector h = o + i;
+	if (h.LengthSquared() == 0.f) return 0.f;
+	h = Normalize(h);
+	float oDotH = Dot(o, h);
+	if (oDotH <= 0.f) return 0.f;
+	// Density of h, converted to a density of the reflected direction
+	return D(h) * h.z / (4.f * oDotH);
+}
\ No newline at end of file
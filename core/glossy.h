@@ -0,0 +1,24 @@
+#pragma once
+
+#include "material.h"
+
+//! Rough metal, a Trowbridge-Reitz (GGX) microfacet distribution with Schlick's Fresnel approximation
+class Glossy : public Material {
+public:
+	Glossy() : color(1.f, 1.f, 1.f), roughness(0.2f) {}
+	Glossy(const Color& color, float roughness) : color(color), roughness(roughness) {}
+
+	Color Eval(const Vector& wo, const Vector& wi) const;
+	//! Samples the microfacet normal from the distribution and reflects wo about it
+	Color Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const;
+	float Pdf(const Vector& wo, const Vector& wi) const;
+	Color GetAlbedo() const { return color; }
+
+	Color color; // Reflectance at normal incidence
+	float roughness; // Width of the distribution, 0 is a mirror and 1 very rough
+
+private:
+	float GetAlpha() const;
+	float D(const Vector& h) const;
+	float G1(const Vector& w) const;
+};
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include "haltonsampler.h"
+#include <algorithm>
+
+static const unsigned primes[] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+	59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+	137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+	227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311
+};
+static const unsigned nPrimes = sizeof(primes) / sizeof(primes[0]);
+
+//! Mirrors the digits of n in base around the decimal point, with every digit position permuted by its own
+//! random affine map, which is a permutation because base is prime
+//! Unlike a plain shift this keeps the first few samples of the high bases spread out
+static float ScrambledRadicalInverse(unsigned n, unsigned base, unsigned seed) {
+	double invBase = 1.0 / base, factor = invBase, result = 0.0;
+	// Also the leading zeros of n are scrambled, up to the precision of a float
+	for (unsigned k = 0; factor > 1e-8; k++) {
+		unsigned h = HashCombine(seed, k);
+		unsigned a = 1 + h % (base - 1), c = (h >> 16) % base;
+		unsigned next = n / base;
+		unsigned digit = n - next * base;
+		result += ((a * digit + c) % base) * factor;
+		factor *= invBase;
+		n = next;
+	}
+	return std::min((float)result, 0.99999994f);
+}
+
+float HaltonSampler::Get1D() {
+	unsigned d = dimension++;
+	unsigned pixelSeed = PixelSeed(d);
+	if (d >= nPrimes)
+		return BitsToFloat(HashCombine(pixelSeed, index));
+	return ScrambledRadicalInverse(index, primes[d], pixelSeed);
+}
+
+void HaltonSampler::Get2D(float* u1, float* u2) {
+	*u1 = Get1D();
+	*u2 = Get1D();
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "sampler.h"
+
+//! Halton sequence with a base per dimension, its digits scrambled differently per pixel and dimension
+//! Dimensions beyond the table of bases get plain random numbers
+class HaltonSampler : public Sampler {
+public:
+	explicit HaltonSampler(unsigned seed = 0) : Sampler(seed) {}
+
+	float Get1D();
+	void Get2D(float* u1, float* u2);
+	Sampler* Clone() const { return new HaltonSampler(seed); }
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "history.h"
+#include <algorithm>
+#include <cmath>
+
+// Largest relative difference between the distance to the reprojected point and the old depth
+static const float depthTolerance = 0.05f;
+// Smallest cosine between the new and old normals
+static const float normalTolerance = 0.9f;
+
+void History::Capture(const Camera& camera) {
+	view = camera;
+	camera.film.Resolve(image);
+	valid = true;
+}
+
+unsigned History::Reproject(Camera& camera) {
+	Film& film = camera.film;
+	if (!valid || image.width != film.GetWidth() || image.height != film.GetHeight()) return 0;
+	valid = false;
+	film.Resolve(current);
+
+	unsigned reused = 0;
+	for (unsigned y = 0; y < current.height; y++) {
+		for (unsigned x = 0; x < current.width; x++) {
+			unsigned i = y * current.width + x;
+			if (current.samples[i] == 0) continue;
+
+			// Point seen through the pixel center, far along the ray if nothing was hit
+			Ray ray = camera.GetJitteredRay(x, y, 0.5f, 0.5f);
+			Vector d = Normalize(ray.d);
+			float depth = current.depth[i];
+			Point p = ray.o + (depth > 0.f ? depth : 1e6f) * d;
+
+			float ox, oy;
+			if (!view.Project(p, ox, oy) || ox < 0.f || oy < 0.f) continue;
+			unsigned hx = (unsigned)ox, hy = (unsigned)oy;
+			if (hx >= image.width || hy >= image.height) continue;
+			unsigned j = hy * image.width + hx;
+			if (image.samples[j] == 0) continue;
+
+			// Disocclusion, the old pixel saw something else than this surface
+			float oldDepth = image.depth[j];
+			if (depth > 0.f) {
+				float expected = Distance(p, view.position);
+				if (fabsf(oldDepth - expected) > depthTolerance * expected) continue;
+				Normal n = current.normal[i], m = image.normal[j];
+				float lengths = n.Length() * m.Length();
+				if (lengths <= 0.f || Dot(n, m) < normalTolerance * lengths) continue;
+			}
+			else if (oldDepth > 0.f) {
+				continue;
+			}
+
+			PixelFeatures features;
+			features.albedo = image.albedo[j];
+			features.normal = image.normal[j];
+			features.depth = 0.f;
+			film.AddHistory(x, y, image.color[j], features, image.variance[j], std::min(image.samples[j], maxSamples));
+			reused++;
+		}
+	}
+	return reused;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "camera.h"
+#include "film.h"
+
+//! The accumulated image of an earlier view, reused when the camera moves instead of starting over
+//! After the first pass in the new view, every pixel is traced back to where its surface was on the old film
+//! The old average is added to the pixel as if it were that many samples, unless the depth or normal there
+//! tell that the surface was hidden or not in view before
+class History {
+public:
+	History() : valid(false), maxSamples(64) {}
+
+	//! Remembers the view and the averaged film of the camera
+	void Capture(const Camera& camera);
+	//! Adds the remembered image to the film of the camera, which must hold a pass of the new view
+	//! Returns the number of pixels that got history
+	unsigned Reproject(Camera& camera);
+	void Invalidate() { valid = false; }
+
+	//! Most samples history counts as, so that view dependent shading catches up with the new view
+	void SetMaxSamples(unsigned n) { maxSamples = n; }
+	unsigned GetMaxSamples() const { return maxSamples; }
+
+private:
+	bool valid;
+	unsigned maxSamples;
+	CameraView view;
+	FilmImage image;
+	FilmImage current; // The first pass of the new view, reused between moves
+};
\ No newline at end of file
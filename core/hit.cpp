@@ -0,0 +1,13 @@
+#include "hit.h"
+#include "shape.h"
+#include "instance.h"
+
+void Hit::Complete(const Ray& ray) {
+	assert(shape);
+	p = ray(t);
+	material = shape->material;
+	if (instance)
+		instance->SetObjectSurface(*this, ray.time);
+	else
+		shape->SetSurface(*this);
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "geometry.h"
+
+class Shape;
+class Instance;
+class Material;
+
+//! Where a ray hit a surface and what the surface looks like there
+//! Traversal only sets t, b1, b2, shape, instance and primitive, Complete derives the rest once the closest hit is known
+struct Hit {
+	Hit() : t(INFINITY), b1(0.f), b2(0.f), shape(NULL), instance(NULL), primitive(0), u(0.f), v(0.f), material(NULL) {}
+
+	float t; // Distance along the ray, in units of its direction
+	float b1, b2; // Barycentric coordinates on triangles, 0 on other shapes
+	const Shape* shape; // NULL if nothing was hit
+	const Instance* instance; // Instance the shape belongs to, NULL if it was added to the world directly
+	unsigned primitive; // Index of the shape among the primitives of the BVH it was found in, that of the instanced mesh for instances
+
+	Point p;
+	Normal ng; // Geometric normal, unit length
+	Normal ns; // Shading normal, unit length, interpolated from vertex normals where the shape has them
+	float u, v; // Texture coordinates, the barycentric coordinates on shapes without them
+	const Material* material;
+
+	//! Derives the point, normals, texture coordinates and material from what traversal set
+	void Complete(const Ray& ray);
+};
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "imageio.h"
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+bool WriteImage(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper) {
+	size_t dot = filename.find_last_of('.');
+	std::string ext = dot == std::string::npos ? "" : filename.substr(dot + 1);
+	for (unsigned i = 0; i < ext.size(); i++)
+		ext[i] = (char)tolower(ext[i]);
+
+	if (ext == "pfm") return WritePFM(filename, image);
+	if (ext == "exr") return WriteEXR(filename, image);
+	if (ext == "ppm") return WritePPM(filename, image, tonemapper);
+	if (ext == "png") return WritePNG(filename, image, tonemapper);
+	std::cerr << "Unknown image format: " << filename << std::endl;
+	return false;
+}
+
+// Little endian writers, so the output does not depend on the machine
+
+static void PutU16(std::vector<unsigned char>& out, unsigned v) {
+	out.push_back((unsigned char)(v & 0xff));
+	out.push_back((unsigned char)((v >> 8) & 0xff));
+}
+
+static void PutU32(std::vector<unsigned char>& out, unsigned v) {
+	PutU16(out, v & 0xffff);
+	PutU16(out, v >> 16);
+}
+
+static void PutU64(std::vector<unsigned char>& out, unsigned long long v) {
+	PutU32(out, (unsigned)(v & 0xffffffffu));
+	PutU32(out, (unsigned)(v >> 32));
+}
+
+static void PutFloat(std::vector<unsigned char>& out, float f) {
+	unsigned v;
+	memcpy(&v, &f, sizeof(v));
+	PutU32(out, v);
+}
+
+static void PutString(std::vector<unsigned char>& out, const char* s) {
+	out.insert(out.end(), s, s + strlen(s) + 1);
+}
+
+static bool WriteFile(const std::string& filename, const std::vector<unsigned char>& data) {
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		std::cerr << "Could not create " << filename << std::endl;
+		return false;
+	}
+	if (!data.empty())
+		file.write((const char*)&data[0], data.size());
+	file.close();
+	if (!file) {
+		std::cerr << "Could not write " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//! Portable float map, rows are stored bottom to top
+bool WritePFM(const std::string& filename, const FilmImage& image) {
+	unsigned width = image.width, height = image.height;
+	std::ostringstream header;
+	header << "PF\n" << width << " " << height << "\n-1.0\n"; // Negative scale means little endian
+	std::string text = header.str();
+	std::vector<unsigned char> data(text.begin(), text.end());
+	data.reserve(data.size() + width * height * 12);
+	for (unsigned y = height; y-- > 0;) {
+		for (unsigned x = 0; x < width; x++) {
+			Color c = image.color[y * width + x];
+			PutFloat(data, c.r);
+			PutFloat(data, c.g);
+			PutFloat(data, c.b);
+		}
+	}
+	return WriteFile(filename, data);
+}
+
+static void PutEXRAttribute(std::vector<unsigned char>& out, const char* name, const char* type, unsigned size) {
+	PutString(out, name);
+	PutString(out, type);
+	PutU32(out, size);
+}
+
+//! Uncompressed scanline OpenEXR with 32 bit float R, G and B channels
+bool WriteEXR(const std::string& filename, const FilmImage& image) {
+	unsigned width = image.width, height = image.height;
+	std::vector<unsigned char> data;
+	PutU32(data, 20000630); // Magic number
+	PutU32(data, 2); // Version 2, single part scanline file
+
+	// Channels have to be listed in alphabetical order
+	const char* channels[3] = { "B", "G", "R" };
+	PutEXRAttribute(data, "channels", "chlist", 3 * 18 + 1);
+	for (unsigned c = 0; c < 3; c++) {
+		PutString(data, channels[c]);
+		PutU32(data, 2); // FLOAT
+		PutU32(data, 0); // pLinear and reserved bytes
+		PutU32(data, 1); // x sampling
+		PutU32(data, 1); // y sampling
+	}
+	data.push_back(0);
+	PutEXRAttribute(data, "compression", "compression", 1);
+	data.push_back(0); // NO_COMPRESSION
+	PutEXRAttribute(data, "dataWindow", "box2i", 16);
+	PutU32(data, 0); PutU32(data, 0); PutU32(data, width - 1); PutU32(data, height - 1);
+	PutEXRAttribute(data, "displayWindow", "box2i", 16);
+	PutU32(data, 0); PutU32(data, 0); PutU32(data, width - 1); PutU32(data, height - 1);
+	PutEXRAttribute(data, "lineOrder", "lineOrder", 1);
+	data.push_back(0); // INCREASING_Y
+	PutEXRAttribute(data, "pixelAspectRatio", "float", 4);
+	PutFloat(data, 1.f);
+	PutEXRAttribute(data, "screenWindowCenter", "v2f", 8);
+	PutFloat(data, 0.f); PutFloat(data, 0.f);
+	PutEXRAttribute(data, "screenWindowWidth", "float", 4);
+	PutFloat(data, 1.f);
+	data.push_back(0); // End of header
+
+	// Every scanline is its own chunk: y, byte count, then all B, all G and all R values
+	unsigned lineSize = width * 3 * 4;
+	unsigned long long offset = data.size() + (unsigned long long)height * 8;
+	for (unsigned y = 0; y < height; y++, offset += 8 + lineSize)
+		PutU64(data, offset);
+	data.reserve(data.size() + height * (8 + lineSize));
+	for (unsigned y = 0; y < height; y++) {
+		PutU32(data, y);
+		PutU32(data, lineSize);
+		for (unsigned x = 0; x < width; x++) PutFloat(data, image.color[y * width + x].b);
+		for (unsigned x = 0; x < width; x++) PutFloat(data, image.color[y * width + x].g);
+		for (unsigned x = 0; x < width; x++) PutFloat(data, image.color[y * width + x].r);
+	}
+	return WriteFile(filename, data);
+}
+
+//! Converts a row of pixels the same way the preview window does and appends it as RGB
+static void PutRGB8Row(std::vector<unsigned char>& out, const Color* pixels, unsigned width, const Tonemapper& tonemapper) {
+	std::vector<unsigned char> rgba(4 * width);
+	tonemapper.ConvertPixels(pixels, width, &rgba[0]);
+	for (unsigned x = 0; x < width; x++) {
+		out.push_back(rgba[4 * x]);
+		out.push_back(rgba[4 * x + 1]);
+		out.push_back(rgba[4 * x + 2]);
+	}
+}
+
+bool WritePPM(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper) {
+	unsigned width = image.width, height = image.height;
+	std::ostringstream header;
+	header << "P6\n" << width << " " << height << "\n255\n";
+	std::string text = header.str();
+	std::vector<unsigned char> data(text.begin(), text.end());
+	data.reserve(data.size() + width * height * 3);
+	for (unsigned y = 0; y < height; y++)
+		PutRGB8Row(data, &image.color[y * width], width, tonemapper);
+	return WriteFile(filename, data);
+}
+
+// PNG stores its integers big endian
+
+static void PutU32BE(std::vector<unsigned char>& out, unsigned v) {
+	out.push_back((unsigned char)(v >> 24));
+	out.push_back((unsigned char)((v >> 16) & 0xff));
+	out.push_back((unsigned char)((v >> 8) & 0xff));
+	out.push_back((unsigned char)(v & 0xff));
+}
+
+static unsigned CRC32(const unsigned char* data, size_t size) {
+	static unsigned table[256];
+	static bool tableDone = false;
+	if (!tableDone) {
+		for (unsigned n = 0; n < 256; n++) {
+			unsigned c = n;
+			for (unsigned k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableDone = true;
+	}
+	unsigned crc = 0xffffffffu;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return crc ^ 0xffffffffu;
+}
+
+static void PutPNGChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& body) {
+	PutU32BE(out, (unsigned)body.size());
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), body.begin(), body.end());
+	PutU32BE(out, CRC32(&out[start], out.size() - start));
+}
+
+//! 8 bit RGB PNG, the image data is stored in uncompressed deflate blocks so no zlib is needed
+bool WritePNG(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper) {
+	unsigned width = image.width, height = image.height;
+
+	// Every row starts with filter type 0
+	std::vector<unsigned char> raw;
+	raw.reserve(height * (1 + width * 3));
+	for (unsigned y = 0; y < height; y++) {
+		raw.push_back(0);
+		PutRGB8Row(raw, &image.color[y * width], width, tonemapper);
+	}
+
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	size_t pos = 0;
+	do {
+		unsigned blockSize = (unsigned)std::min<size_t>(raw.size() - pos, 65535);
+		zlib.push_back(pos + blockSize == raw.size() ? 1 : 0); // Final block flag, stored block type
+		PutU16(zlib, blockSize);
+		PutU16(zlib, ~blockSize & 0xffff);
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + blockSize);
+		pos += blockSize;
+	} while (pos < raw.size());
+	unsigned a = 1, b = 0; // Adler-32 of the uncompressed data
+	for (size_t i = 0; i < raw.size(); i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	PutU32BE(zlib, (b << 16) | a);
+
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	std::vector<unsigned char> data(signature, signature + 8);
+	std::vector<unsigned char> header;
+	PutU32BE(header, width);
+	PutU32BE(header, height);
+	header.push_back(8); // Bit depth
+	header.push_back(2); // Truecolor
+	header.push_back(0); // Compression
+	header.push_back(0); // Filter
+	header.push_back(0); // No interlacing
+	PutPNGChunk(data, "IHDR", header);
+	PutPNGChunk(data, "IDAT", zlib);
+	PutPNGChunk(data, "IEND", std::vector<unsigned char>());
+	return WriteFile(filename, data);
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "film.h"
+#include "tonemapper.h"
+#include <string>
+
+//! Writes the colors of a resolved film to an image file, picked by the file extension
+//! PFM and EXR keep the full floating point radiance, PPM and PNG are 8 bit sRGB made by the tonemapper
+bool WriteImage(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper);
+bool WritePFM(const std::string& filename, const FilmImage& image);
+bool WriteEXR(const std::string& filename, const FilmImage& image);
+bool WritePPM(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper);
+bool WritePNG(const std::string& filename, const FilmImage& image, const Tonemapper& tonemapper);
\ No newline at end of file
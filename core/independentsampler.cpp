@@ -0,0 +1,14 @@
+#include "independentsampler.h"
+
+float IndependentSampler::Get1D() {
+	if (dimension != rngDimension)
+		rng.Seed(HashCombine(PixelSeed(0), index), dimension);
+	dimension++;
+	rngDimension = dimension;
+	return rng.Uniform();
+}
+
+void IndependentSampler::Get2D(float* u1, float* u2) {
+	*u1 = Get1D();
+	*u2 = Get1D();
+}
\ No newline at end of file
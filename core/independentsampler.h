@@ -0,0 +1,26 @@
+#pragma once
+
+#include "sampler.h"
+
+//! Plain random numbers without any stratification
+//! Each call to StartPixel or SetDimension starts a PCG stream selected by the dimension it starts at
+class IndependentSampler : public Sampler {
+public:
+	explicit IndependentSampler(unsigned seed = 0) : Sampler(seed), rngDimension(~0u) {}
+
+	void StartPixel(unsigned px, unsigned py, unsigned sampleIndex) {
+		Sampler::StartPixel(px, py, sampleIndex);
+		rngDimension = ~0u;
+	}
+	void SetDimension(unsigned d) {
+		Sampler::SetDimension(d);
+		rngDimension = ~0u;
+	}
+	float Get1D();
+	void Get2D(float* u1, float* u2);
+	Sampler* Clone() const { return new IndependentSampler(seed); }
+
+private:
+	RNG rng;
+	unsigned rngDimension; // Dimension that the next number from rng belongs to
+};
\ No newline at end of file
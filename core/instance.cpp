@@ -0,0 +1,92 @@
+#include "instance.h"
+#include <cstring>
+
+void InstancedMesh::Build() {
+	if (mesh->triangles.empty())
+		mesh->CreateTriangles();
+	std::vector<Shape*> shapes(mesh->triangles.size());
+	for (unsigned i = 0; i < shapes.size(); i++)
+		shapes[i] = &mesh->triangles[i];
+	bvh.Build(shapes);
+}
+
+void InstancedMesh::Restore(std::vector<LinearBVHNode>& nodes, const std::vector<unsigned>& triangles, const BVHArrays& arrays) {
+	if (mesh->triangles.empty())
+		mesh->CreateTriangles();
+	std::vector<Shape*> shapes(triangles.size());
+	for (unsigned i = 0; i < shapes.size(); i++) {
+		assert(triangles[i] < mesh->triangles.size());
+		shapes[i] = &mesh->triangles[triangles[i]];
+	}
+	bvh.Restore(nodes, shapes, arrays);
+}
+
+void InstancedMesh::GetBVHTriangles(std::vector<unsigned>& triangles) const {
+	const std::vector<Shape*>& shapes = bvh.GetPrimitives();
+	triangles.resize(shapes.size());
+	for (unsigned i = 0; i < shapes.size(); i++)
+		triangles[i] = (unsigned)(static_cast<const MeshTriangle*>(shapes[i]) - &mesh->triangles[0]);
+}
+
+Instance::Instance(const InstancedMesh* object, const Transform& objectToWorld)
+	: Shape(object->GetMesh()->material), object(object), moving(false) {
+	SetTransform(objectToWorld);
+}
+
+void Instance::SetTransform(const Transform& objectToWorld) {
+	SetTransform(objectToWorld, objectToWorld);
+}
+
+void Instance::SetTransform(const Transform& start, const Transform& end) {
+	objectToWorld[0] = start;
+	objectToWorld[1] = end;
+	moving = false;
+	for (unsigned i = 0; i < 2; i++) {
+		worldToObject[i] = objectToWorld[i].Inverse();
+		bounds[i] = object->IsBuilt() ? objectToWorld[i](object->GetBounds()) : BBox();
+		moving |= memcmp(&objectToWorld[i], &start, sizeof(Transform)) != 0;
+	}
+}
+
+bool Instance::IntersectObject(const Ray& ray, Hit& hit) const {
+	if (moving)
+		return object->GetBVH().Intersect(Lerp(ray.time, objectToWorld[0], objectToWorld[1]).Inverse()(ray), hit);
+	return object->GetBVH().Intersect(worldToObject[0](ray), hit);
+}
+
+bool Instance::OccludedObject(const Ray& ray) const {
+	if (moving)
+		return object->GetBVH().Occluded(Lerp(ray.time, objectToWorld[0], objectToWorld[1]).Inverse()(ray));
+	return object->GetBVH().Occluded(worldToObject[0](ray));
+}
+
+//! The triangle fills in hit in object space, the point is put back and the normals are taken to world space
+void Instance::SetObjectSurface(Hit& hit, float time) const {
+	Point p = hit.p;
+	if (moving) {
+		Transform transform = Lerp(time, objectToWorld[0], objectToWorld[1]);
+		hit.p = transform.Inverse()(p);
+		hit.shape->SetSurface(hit);
+		hit.ng = Normalize(transform(hit.ng));
+		hit.ns = Normalize(transform(hit.ns));
+	}
+	else {
+		hit.p = worldToObject[0](p);
+		hit.shape->SetSurface(hit);
+		hit.ng = Normalize(objectToWorld[0](hit.ng));
+		hit.ns = Normalize(objectToWorld[0](hit.ns));
+	}
+	hit.p = p;
+}
+
+bool Instance::Intersect(const Ray& ray, float& t) const {
+	Hit hit;
+	if (!IntersectObject(ray, hit)) return false;
+	t = hit.t;
+	return true;
+}
+
+Normal Instance::GetNormal(const Point& p) const {
+	assert(false); // Which triangle was hit is needed, see SetObjectSurface
+	return Normal();
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "shape.h"
+#include "bvh.h"
+#include "transform.h"
+#include "trianglemesh.h"
+
+//! Geometry that any number of instances share: a mesh and a BVH over its triangles, both in object space
+//! This is the bottom level of the two-level acceleration structure, it is built once however many instances there are
+class InstancedMesh {
+public:
+	explicit InstancedMesh(TriangleMesh* mesh) : mesh(mesh) {}
+
+	//! Prepares the triangles and builds the BVH, call once after the mesh buffers are filled in
+	void Build();
+	//! Same, but with a BVH built earlier, see BVH::Restore
+	//! triangles are the indices of the triangles that GetBVH().GetPrimitives() lists
+	void Restore(std::vector<LinearBVHNode>& nodes, const std::vector<unsigned>& triangles, const BVHArrays& arrays);
+	void GetBVHTriangles(std::vector<unsigned>& triangles) const;
+	//! False until built, and also afterwards if the mesh has no triangles
+	bool IsBuilt() const { return bvh.IsBuilt(); }
+
+	const TriangleMesh* GetMesh() const { return mesh; }
+	TriangleMesh* GetMesh() { return mesh; }
+	BVH& GetBVH() { return bvh; }
+	const BVH& GetBVH() const { return bvh; }
+	BBox GetBounds() const { return bvh.GetBounds(); }
+
+private:
+	TriangleMesh* mesh; // Not owned
+	BVH bvh;
+};
+
+//! A copy of an instanced mesh placed in the world by a transform
+//! Rays are taken to object space to intersect the shared geometry, so an instance costs no more memory than its transform
+//! Its triangles are not sampled as lights, emission is only picked up when a path hits them
+class Instance : public Shape {
+public:
+	Instance(const InstancedMesh* object, const Transform& objectToWorld);
+
+	//! Moves the instance, the top level has to be updated with World::UpdateInstances or World::Refit afterwards
+	void SetTransform(const Transform& objectToWorld);
+	//! Moves the instance from start at time 0 to end at time 1 of the shutter interval, for motion blur
+	void SetTransform(const Transform& start, const Transform& end);
+	//! Transform when the shutter opens
+	const Transform& GetTransform() const { return objectToWorld[0]; }
+	bool IsMoving() const { return moving; }
+	const InstancedMesh* GetInstancedMesh() const { return object; }
+
+	//! Finds the closest triangle hit by the world space ray closer than ray.maxt, where the instance is at ray.time
+	//! hit is left as BVH::Intersect leaves it, its shape is the triangle of the shared mesh and t is the same in world and object space
+	bool IntersectObject(const Ray& ray, Hit& hit) const;
+	//! Whether any triangle lies along the world space ray closer than ray.maxt
+	bool OccludedObject(const Ray& ray) const;
+	//! Fills in the world space normals and texture coordinates of hit, found on this instance by a ray at time, see Hit::Complete
+	void SetObjectSurface(Hit& hit, float time) const;
+
+	// Shape interface, used to build the top level over instances
+	bool Intersect(const Ray& ray, float& t) const;
+	Normal GetNormal(const Point& p) const;
+	BBox GetBounds() const { return bounds[0].Union(bounds[0], bounds[1]); }
+	//! The corners of the bounds move linearly, just like every point of the instance does, see Lerp(Transform)
+	BBox GetBoundsAt(float time) const { return Lerp(time, bounds[0], bounds[1]); }
+
+private:
+	const InstancedMesh* object;
+	Transform objectToWorld[2], worldToObject[2]; // When the shutter opens and closes
+	BBox bounds[2]; // In world space
+	bool moving;
+};
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include "lambert.h"
+#include <algorithm>
+
+Color Lambert::Eval(const Vector& wo, const Vector& wi) const {
+	if (!SameHemisphere(wo, wi)) return Color();
+	return color * (1.f / PI);
+}
+
+//! Cosine weighted, so the cosine and the pdf cancel out
+Color Lambert::Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const {
+	float r = sqrtf(u1);
+	float phi = 2.f * PI * u2;
+	float z = sqrtf(std::max(0.f, 1.f - u1));
+	*wi = Vector(r * cosf(phi), r * sinf(phi), wo.z < 0.f ? -z : z);
+	*pdf = z * (1.f / PI);
+	*specular = false;
+	return Eval(wo, *wi);
+}
+
+float Lambert::Pdf(const Vector& wo, const Vector& wi) const {
+	return SameHemisphere(wo, wi) ? fabsf(wi.z) * (1.f / PI) : 0.f;
+}
\ No newline at end of file
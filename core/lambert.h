@@ -0,0 +1,17 @@
+#pragma once
+
+#include "material.h"
+
+//! Ideal diffuse surface, scatters the same amount of light in every direction on the side it was lit from
+class Lambert : public Material {
+public:
+	Lambert() : color(1.f, 1.f, 1.f) {}
+	explicit Lambert(const Color& color) : color(color) {}
+
+	Color Eval(const Vector& wo, const Vector& wi) const;
+	Color Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const;
+	float Pdf(const Vector& wo, const Vector& wi) const;
+	Color GetAlbedo() const { return color; }
+
+	Color color; // Fraction of the light that is reflected
+};
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data(NULL), size(0), file(INVALID_HANDLE_VALUE), mapping(NULL) {
+}
+
+bool MappedFile::Open(const std::string& filename) {
+	Close();
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || (unsigned long long)fileSize.QuadPart > (size_t)-1) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping) {
+		Close();
+		return false;
+	}
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	data = NULL;
+	size = 0;
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : data(NULL), size(0), fd(-1) {
+}
+
+bool MappedFile::Open(const std::string& filename) {
+	Close();
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		Close();
+		return false;
+	}
+	size = (size_t)st.st_size;
+
+	void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	data = (const char*)p;
+	return true;
+}
+
+void MappedFile::Close() {
+	if (data) munmap((void*)data, size);
+	if (fd >= 0) close(fd);
+	data = NULL;
+	size = 0;
+	fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//! Read-only view of a whole file, mapped into memory instead of read into a buffer
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const std::string& filename);
+	void Close();
+
+	const char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	// Not copyable, the mapping has a single owner
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int fd;
+#endif
+};
\ No newline at end of file
@@ -1,8 +1,44 @@
-#pragma once
-
-#include "color.h"
-
-class Material {
-public:
-	Color emittance;
+#pragma once
+
+#include "color.h"
+#include "geometry.h"
+
+//! Orthonormal basis around a shading normal, materials work with directions expressed in it
+//! The normal is the z axis, so the cosine of a direction with the normal is just its z component
+class ShadingFrame {
+public:
+	explicit ShadingFrame(const Normal& n) : n(n.x, n.y, n.z) {
+		CoordinateSystem(this->n, &s, &t);
+	}
+
+	Vector ToLocal(const Vector& v) const { return Vector(Dot(v, s), Dot(v, t), Dot(v, n)); }
+	Vector ToWorld(const Vector& v) const { return s * v.x + t * v.y + n * v.z; }
+
+private:
+	Vector s, t, n;
+};
+
+inline bool SameHemisphere(const Vector& a, const Vector& b) { return a.z * b.z > 0.f; }
+
+//! Describes how a surface scatters and emits light
+//! Shared between all shapes made of the same material
+//! All directions are unit vectors in the ShadingFrame of the surface and point away from it
+class Material {
+public:
+	virtual ~Material() {}
+
+	//! Scattering function: the fraction of light arriving from wi that leaves towards wo, per unit solid angle
+	virtual Color Eval(const Vector& wo, const Vector& wi) const = 0;
+	//! Picks wi for a given wo using u1 and u2 uniform in [0,1), roughly in proportion to Eval times the cosine
+	//! Returns Eval(wo, wi) and the density of wi per unit solid angle in pdf
+	//! Perfectly specular materials set specular, their pdf is 1 and the returned value is divided by the cosine
+	virtual Color Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const = 0;
+	//! Density with which Sample picks wi for wo
+	virtual float Pdf(const Vector& wo, const Vector& wi) const = 0;
+	//! True if Eval is 0 for every pair of directions, so sampling lights is of no use
+	virtual bool IsSpecular() const { return false; }
+	//! Overall color of the surface, the denoiser divides it out so that it does not blur surface detail
+	virtual Color GetAlbedo() const = 0;
+
+	Color emittance;
 };
\ No newline at end of file
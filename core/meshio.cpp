@@ -0,0 +1,449 @@
+#include "meshio.h"
+#include "mappedfile.h"
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+bool LoadMesh(const std::string& filename, TriangleMesh& mesh) {
+	size_t dot = filename.find_last_of('.');
+	std::string ext = dot == std::string::npos ? "" : filename.substr(dot + 1);
+	for (unsigned i = 0; i < ext.size(); i++)
+		ext[i] = (char)tolower(ext[i]);
+
+	if (ext == "obj") return LoadOBJ(filename, mesh);
+	if (ext == "ply") return LoadPLY(filename, mesh);
+	std::cerr << "Unknown mesh format: " << filename << std::endl;
+	return false;
+}
+
+// Wavefront OBJ
+
+//! Cursor over the mapped text of an OBJ file
+struct OBJParser {
+	OBJParser(const char* p, const char* end) : p(p), end(end) {}
+
+	void SkipSpaces() {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	}
+	void SkipLine() {
+		while (p < end && *p != '\n') p++;
+		if (p < end) p++;
+	}
+	bool AtLineEnd() {
+		SkipSpaces();
+		return p >= end || *p == '\n' || *p == '#';
+	}
+
+	//! Parses a decimal number with optional fraction and exponent
+	float ParseFloat() {
+		SkipSpaces();
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+		double value = 0.0;
+		while (p < end && *p >= '0' && *p <= '9')
+			value = value * 10.0 + (*p++ - '0');
+		if (p < end && *p == '.') {
+			p++;
+			double scale = 0.1;
+			while (p < end && *p >= '0' && *p <= '9') {
+				value += (*p++ - '0') * scale;
+				scale *= 0.1;
+			}
+		}
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			p++;
+			bool negExp = false;
+			if (p < end && (*p == '-' || *p == '+')) negExp = *p++ == '-';
+			int exponent = 0;
+			while (p < end && *p >= '0' && *p <= '9')
+				exponent = exponent * 10 + (*p++ - '0');
+			value *= pow(10.0, negExp ? -exponent : exponent);
+		}
+		return (float)(negative ? -value : value);
+	}
+
+	int ParseInt() {
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+		int value = 0;
+		while (p < end && *p >= '0' && *p <= '9')
+			value = value * 10 + (*p++ - '0');
+		return negative ? -value : value;
+	}
+
+	const char* p;
+	const char* end;
+};
+
+//! Position, texture coordinate and normal index of a face corner, -1 if absent
+struct OBJVertex {
+	int v, vt, vn;
+	bool operator==(const OBJVertex& o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+};
+
+struct OBJVertexHash {
+	size_t operator()(const OBJVertex& k) const {
+		return (size_t)k.v * 73856093u ^ (size_t)k.vt * 19349663u ^ (size_t)k.vn * 83492791u;
+	}
+};
+
+//! Turns a 1-based or negative (relative) OBJ index into a 0-based one
+static int ResolveOBJIndex(int index, size_t count) {
+	if (index > 0) return index - 1;
+	if (index < 0) return (int)count + index;
+	return -1;
+}
+
+bool LoadOBJ(const std::string& filename, TriangleMesh& mesh) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		std::cerr << "Could not open " << filename << std::endl;
+		return false;
+	}
+
+	std::vector<Point> positions;
+	std::vector<Normal> normals;
+	std::vector<float> uvs;
+	std::vector<OBJVertex> corners; // Three per triangle
+	bool hasAttributes = false;
+
+	// Rough guess so that large files do not keep reallocating
+	positions.reserve(file.GetSize() / 80);
+	corners.reserve(file.GetSize() / 20);
+
+	OBJParser parser(file.GetData(), file.GetData() + file.GetSize());
+	std::vector<OBJVertex> face;
+	while (parser.p < parser.end) {
+		parser.SkipSpaces();
+		const char* p = parser.p;
+		size_t left = parser.end - p;
+		if (left >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			parser.p += 2;
+			float x = parser.ParseFloat(), y = parser.ParseFloat(), z = parser.ParseFloat();
+			positions.push_back(Point(x, y, z));
+		}
+		else if (left >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			parser.p += 3;
+			float x = parser.ParseFloat(), y = parser.ParseFloat(), z = parser.ParseFloat();
+			normals.push_back(Normal(x, y, z));
+		}
+		else if (left >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+			parser.p += 3;
+			float u = parser.ParseFloat(), v = parser.ParseFloat();
+			uvs.push_back(u);
+			uvs.push_back(v);
+		}
+		else if (left >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			parser.p += 2;
+			face.clear();
+			while (!parser.AtLineEnd()) {
+				OBJVertex corner;
+				corner.v = ResolveOBJIndex(parser.ParseInt(), positions.size());
+				corner.vt = corner.vn = -1;
+				if (parser.p < parser.end && *parser.p == '/') {
+					parser.p++;
+					if (parser.p < parser.end && *parser.p != '/')
+						corner.vt = ResolveOBJIndex(parser.ParseInt(), uvs.size() / 2);
+					if (parser.p < parser.end && *parser.p == '/') {
+						parser.p++;
+						corner.vn = ResolveOBJIndex(parser.ParseInt(), normals.size());
+					}
+				}
+				if (corner.v < 0 || corner.v >= (int)positions.size()) {
+					std::cerr << filename << ": face refers to a missing vertex" << std::endl;
+					return false;
+				}
+				if (corner.vt >= (int)(uvs.size() / 2)) corner.vt = -1;
+				if (corner.vn >= (int)normals.size()) corner.vn = -1;
+				hasAttributes |= corner.vt >= 0 || corner.vn >= 0;
+				face.push_back(corner);
+				// Skip anything that is not part of a vertex reference
+				while (parser.p < parser.end && *parser.p != ' ' && *parser.p != '\t' && *parser.p != '\n' && *parser.p != '\r')
+					parser.p++;
+			}
+			for (unsigned i = 2; i < face.size(); i++) {
+				corners.push_back(face[0]);
+				corners.push_back(face[i-1]);
+				corners.push_back(face[i]);
+			}
+		}
+		parser.SkipLine();
+	}
+
+	if (corners.empty()) {
+		std::cerr << filename << ": no faces found" << std::endl;
+		return false;
+	}
+
+	mesh.positions.clear();
+	mesh.normals.clear();
+	mesh.uvs.clear();
+	mesh.indices.clear();
+	mesh.indices.reserve(corners.size());
+
+	if (!hasAttributes) {
+		// Positions can be used as they are
+		mesh.positions.swap(positions);
+		for (unsigned i = 0; i < corners.size(); i++)
+			mesh.indices.push_back((unsigned)corners[i].v);
+		return true;
+	}
+
+	// Every distinct combination of position, uv and normal becomes one mesh vertex
+	bool useNormals = !normals.empty(), useUVs = !uvs.empty();
+	std::unordered_map<OBJVertex, unsigned, OBJVertexHash> vertexIds;
+	for (unsigned i = 0; i < corners.size(); i++) {
+		const OBJVertex& c = corners[i];
+		std::unordered_map<OBJVertex, unsigned, OBJVertexHash>::iterator it = vertexIds.find(c);
+		if (it != vertexIds.end()) {
+			mesh.indices.push_back(it->second);
+			continue;
+		}
+		unsigned id = (unsigned)mesh.positions.size();
+		vertexIds[c] = id;
+		mesh.positions.push_back(positions[c.v]);
+		if (useNormals)
+			mesh.normals.push_back(c.vn >= 0 ? normals[c.vn] : Normal());
+		if (useUVs) {
+			mesh.uvs.push_back(c.vt >= 0 ? uvs[2 * c.vt] : 0.f);
+			mesh.uvs.push_back(c.vt >= 0 ? uvs[2 * c.vt + 1] : 0.f);
+		}
+		mesh.indices.push_back(id);
+	}
+	return true;
+}
+
+// Binary PLY
+
+enum PLYType { PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64, PLY_INVALID };
+
+static PLYType ParsePLYType(const std::string& name) {
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	return PLY_INVALID;
+}
+
+static unsigned PLYTypeSize(PLYType type) {
+	static const unsigned sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+	return sizes[type];
+}
+
+//! Reads a value of the given type, swapping bytes if the file endianness differs from ours
+static double ReadPLYValue(const char* p, PLYType type, bool swap) {
+	unsigned char bytes[8];
+	unsigned size = PLYTypeSize(type);
+	memcpy(bytes, p, size);
+	if (swap) std::reverse(bytes, bytes + size);
+	switch (type) {
+	case PLY_INT8: return (double)*(signed char*)bytes;
+	case PLY_UINT8: return (double)*(unsigned char*)bytes;
+	case PLY_INT16: { short v; memcpy(&v, bytes, 2); return v; }
+	case PLY_UINT16: { unsigned short v; memcpy(&v, bytes, 2); return v; }
+	case PLY_INT32: { int v; memcpy(&v, bytes, 4); return v; }
+	case PLY_UINT32: { unsigned v; memcpy(&v, bytes, 4); return v; }
+	case PLY_FLOAT32: { float v; memcpy(&v, bytes, 4); return v; }
+	case PLY_FLOAT64: { double v; memcpy(&v, bytes, 8); return v; }
+	default: return 0.0;
+	}
+}
+
+struct PLYProperty {
+	std::string name;
+	PLYType type;
+	PLYType countType; // PLY_INVALID unless this is a list
+};
+
+struct PLYElement {
+	std::string name;
+	unsigned count;
+	std::vector<PLYProperty> properties;
+};
+
+bool LoadPLY(const std::string& filename, TriangleMesh& mesh) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		std::cerr << "Could not open " << filename << std::endl;
+		return false;
+	}
+	const char* p = file.GetData();
+	const char* end = p + file.GetSize();
+
+	// Header is plain text, one statement per line
+	std::vector<PLYElement> elements;
+	bool binary = false, bigEndian = false, headerDone = false, first = true;
+	while (p < end && !headerDone) {
+		const char* lineEnd = p;
+		while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+		std::string line(p, lineEnd);
+		if (!line.empty() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+		p = lineEnd < end ? lineEnd + 1 : end;
+
+		std::vector<std::string> words;
+		size_t pos = 0;
+		while (pos < line.size()) {
+			size_t start = line.find_first_not_of(" \t", pos);
+			if (start == std::string::npos) break;
+			size_t stop = line.find_first_of(" \t", start);
+			if (stop == std::string::npos) stop = line.size();
+			words.push_back(line.substr(start, stop - start));
+			pos = stop;
+		}
+
+		if (first) {
+			if (words.empty() || words[0] != "ply") {
+				std::cerr << filename << ": not a PLY file" << std::endl;
+				return false;
+			}
+			first = false;
+		}
+		else if (words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+		}
+		else if (words[0] == "format" && words.size() >= 2) {
+			binary = words[1] != "ascii";
+			bigEndian = words[1] == "binary_big_endian";
+		}
+		else if (words[0] == "element" && words.size() >= 3) {
+			PLYElement element;
+			element.name = words[1];
+			element.count = (unsigned)strtoul(words[2].c_str(), NULL, 10);
+			elements.push_back(element);
+		}
+		else if (words[0] == "property" && !elements.empty()) {
+			PLYProperty property;
+			if (words.size() >= 5 && words[1] == "list") {
+				property.countType = ParsePLYType(words[2]);
+				property.type = ParsePLYType(words[3]);
+				property.name = words[4];
+				if (property.countType == PLY_INVALID) property.type = PLY_INVALID;
+			}
+			else if (words.size() >= 3) {
+				property.countType = PLY_INVALID;
+				property.type = ParsePLYType(words[1]);
+				property.name = words[2];
+			}
+			else {
+				property.type = PLY_INVALID;
+			}
+			if (property.type == PLY_INVALID) {
+				std::cerr << filename << ": unsupported property: " << line << std::endl;
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+		else if (words[0] == "end_header") {
+			headerDone = true;
+		}
+	}
+	if (!headerDone || !binary) {
+		std::cerr << filename << ": only binary PLY files are supported" << std::endl;
+		return false;
+	}
+
+	unsigned short one = 1;
+	bool hostBigEndian = *(unsigned char*)&one == 0;
+	bool swap = bigEndian != hostBigEndian;
+
+	mesh.positions.clear();
+	mesh.normals.clear();
+	mesh.uvs.clear();
+	mesh.indices.clear();
+
+	for (unsigned e = 0; e < elements.size(); e++) {
+		const PLYElement& element = elements[e];
+		bool isVertex = element.name == "vertex";
+		bool isFace = element.name == "face";
+
+		// Map the vertex attributes we know onto property slots
+		int slots[8]; // x y z nx ny nz u v
+		for (unsigned i = 0; i < 8; i++) slots[i] = -1;
+		for (unsigned i = 0; i < element.properties.size(); i++) {
+			const std::string& n = element.properties[i].name;
+			if (n == "x") slots[0] = i;
+			else if (n == "y") slots[1] = i;
+			else if (n == "z") slots[2] = i;
+			else if (n == "nx") slots[3] = i;
+			else if (n == "ny") slots[4] = i;
+			else if (n == "nz") slots[5] = i;
+			else if (n == "u" || n == "s" || n == "texture_u" || n == "texture_s") slots[6] = i;
+			else if (n == "v" || n == "t" || n == "texture_v" || n == "texture_t") slots[7] = i;
+		}
+		if (isVertex) {
+			if (slots[0] < 0 || slots[1] < 0 || slots[2] < 0) {
+				std::cerr << filename << ": vertices without positions" << std::endl;
+				return false;
+			}
+			mesh.positions.reserve(element.count);
+		}
+		bool readNormals = isVertex && slots[3] >= 0 && slots[4] >= 0 && slots[5] >= 0;
+		bool readUVs = isVertex && slots[6] >= 0 && slots[7] >= 0;
+		if (isFace) mesh.indices.reserve(element.count * 3);
+
+		double values[8];
+		std::vector<unsigned> polygon;
+		for (unsigned item = 0; item < element.count; item++) {
+			for (unsigned i = 0; i < element.properties.size(); i++) {
+				const PLYProperty& property = element.properties[i];
+				if (property.countType != PLY_INVALID) {
+					// List property
+					if (p + PLYTypeSize(property.countType) > end) goto truncated;
+					unsigned n = (unsigned)ReadPLYValue(p, property.countType, swap);
+					p += PLYTypeSize(property.countType);
+					unsigned size = PLYTypeSize(property.type);
+					if (p + (size_t)n * size > end) goto truncated;
+					if (isFace && (property.name == "vertex_indices" || property.name == "vertex_index")) {
+						polygon.clear();
+						for (unsigned k = 0; k < n; k++)
+							polygon.push_back((unsigned)ReadPLYValue(p + k * size, property.type, swap));
+						for (unsigned k = 2; k < polygon.size(); k++) {
+							mesh.indices.push_back(polygon[0]);
+							mesh.indices.push_back(polygon[k-1]);
+							mesh.indices.push_back(polygon[k]);
+						}
+					}
+					p += (size_t)n * size;
+				}
+				else {
+					if (p + PLYTypeSize(property.type) > end) goto truncated;
+					if (isVertex) {
+						for (unsigned s = 0; s < 8; s++)
+							if (slots[s] == (int)i) values[s] = ReadPLYValue(p, property.type, swap);
+					}
+					p += PLYTypeSize(property.type);
+				}
+			}
+			if (isVertex) {
+				mesh.positions.push_back(Point((float)values[0], (float)values[1], (float)values[2]));
+				if (readNormals) mesh.normals.push_back(Normal((float)values[3], (float)values[4], (float)values[5]));
+				if (readUVs) {
+					mesh.uvs.push_back((float)values[6]);
+					mesh.uvs.push_back((float)values[7]);
+				}
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < mesh.indices.size(); i++) {
+		if (mesh.indices[i] >= mesh.positions.size()) {
+			std::cerr << filename << ": face refers to a missing vertex" << std::endl;
+			return false;
+		}
+	}
+	if (mesh.indices.empty()) {
+		std::cerr << filename << ": no faces found" << std::endl;
+		return false;
+	}
+	return true;
+
+truncated:
+	std::cerr << filename << ": file is truncated" << std::endl;
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "trianglemesh.h"
+#include <string>
+
+//! Loads a mesh from a Wavefront OBJ or binary PLY file, picked by the file extension
+//! Files are memory mapped and parsed in place, polygons are split into triangle fans
+bool LoadMesh(const std::string& filename, TriangleMesh& mesh);
+bool LoadOBJ(const std::string& filename, TriangleMesh& mesh);
+bool LoadPLY(const std::string& filename, TriangleMesh& mesh);
\ No newline at end of file
@@ -0,0 +1,9 @@
+#include "mirror.h"
+
+Color Mirror::Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const {
+	*wi = Vector(-wo.x, -wo.y, wo.z);
+	*pdf = 1.f;
+	*specular = true;
+	if (wo.z == 0.f) return Color();
+	return color / fabsf(wo.z);
+}
\ No newline at end of file
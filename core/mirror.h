@@ -0,0 +1,18 @@
+#pragma once
+
+#include "material.h"
+
+//! Perfectly smooth reflector
+class Mirror : public Material {
+public:
+	Mirror() : color(1.f, 1.f, 1.f) {}
+	explicit Mirror(const Color& color) : color(color) {}
+
+	Color Eval(const Vector& wo, const Vector& wi) const { return Color(); }
+	Color Sample(const Vector& wo, float u1, float u2, Vector* wi, float* pdf, bool* specular) const;
+	float Pdf(const Vector& wo, const Vector& wi) const { return 0.f; }
+	bool IsSpecular() const { return true; }
+	Color GetAlbedo() const { return color; }
+
+	Color color; // Fraction of the light that is reflected
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include "pathqueue.h"
+
+void PathQueue::Reserve(unsigned n) {
+	if (ox.size() >= n) return;
+	ox.resize(n); oy.resize(n); oz.resize(n);
+	dx.resize(n); dy.resize(n); dz.resize(n);
+	mint.resize(n);
+	time.resize(n);
+	tr.resize(n); tg.resize(n); tb.resize(n);
+	pixel.resize(n);
+	specular.resize(n);
+	pdf.resize(n);
+	t.resize(n); b1.resize(n); b2.resize(n);
+	shape.resize(n);
+	instance.resize(n);
+	primitive.resize(n);
+}
+
+void PathQueue::Push(const Ray& ray, unsigned pixelIndex, const Color& throughput, bool isSpecular, float directionPdf) {
+	assert(size < ox.size());
+	unsigned i = size++;
+	ox[i] = ray.o.x; oy[i] = ray.o.y; oz[i] = ray.o.z;
+	dx[i] = ray.d.x; dy[i] = ray.d.y; dz[i] = ray.d.z;
+	mint[i] = ray.mint;
+	time[i] = ray.time;
+	tr[i] = throughput.r; tg[i] = throughput.g; tb[i] = throughput.b;
+	pixel[i] = pixelIndex;
+	specular[i] = isSpecular ? 1 : 0;
+	pdf[i] = directionPdf;
+	shape[i] = NULL;
+	instance[i] = NULL;
+}
+
+Hit PathQueue::GetHit(unsigned i) const {
+	Hit hit;
+	hit.t = t[i];
+	hit.b1 = b1[i];
+	hit.b2 = b2[i];
+	hit.shape = shape[i];
+	hit.instance = instance[i];
+	hit.primitive = primitive[i];
+	return hit;
+}
+
+void PathQueue::SetHit(unsigned i, const Hit& hit) {
+	t[i] = hit.t;
+	b1[i] = hit.b1;
+	b2[i] = hit.b2;
+	shape[i] = hit.shape;
+	instance[i] = hit.instance;
+	primitive[i] = hit.primitive;
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "geometry.h"
+#include "color.h"
+#include "hit.h"
+#include <vector>
+
+class Material;
+
+//! Rays of one wavefront bounce together with the state of their paths, stored as structure of arrays
+//! The hit arrays are filled in by the extend stage of the wavefront renderer
+class PathQueue {
+public:
+	PathQueue() : size(0) {}
+
+	//! Makes room for n paths, so pushing never has to reallocate
+	void Reserve(unsigned n);
+	void Clear() { size = 0; }
+	unsigned GetSize() const { return size; }
+
+	void Push(const Ray& ray, unsigned pixel, const Color& throughput, bool specular, float pdf);
+	Ray GetRay(unsigned i) const {
+		return Ray(Point(ox[i], oy[i], oz[i]), Vector(dx[i], dy[i], dz[i]), mint[i], INFINITY, time[i]);
+	}
+	Color GetThroughput(unsigned i) const { return Color(tr[i], tg[i], tb[i]); }
+	//! Closest hit of path i as traversal found it, see Hit::Complete
+	Hit GetHit(unsigned i) const;
+	void SetHit(unsigned i, const Hit& hit);
+
+	std::vector<float> ox, oy, oz; // Origins
+	std::vector<float> dx, dy, dz; // Directions
+	std::vector<float> mint;
+	std::vector<float> time; // Within the shutter interval
+	std::vector<float> tr, tg, tb; // Throughput of the path up to this ray
+	std::vector<unsigned> pixel; // Pixel the path contributes to
+	std::vector<unsigned char> specular; // 1 if the ray was not sampled from a material with a density, see Renderer::Scatter
+	std::vector<float> pdf; // Density with which the ray direction was sampled otherwise
+
+	std::vector<float> t, b1, b2; // Distance and barycentric coordinates of the closest hit
+	std::vector<const Shape*> shape; // Closest shape hit, NULL if none
+	std::vector<const Instance*> instance; // Instance the closest shape belongs to, NULL if it is not instanced
+	std::vector<unsigned> primitive; // See Hit::primitive
+
+private:
+	unsigned size;
+};
+
+//! Entry of a path queue that has a hit to shade
+//! Sorting these groups hits on the same material together
+struct ShadeItem {
+	const Material* material;
+	unsigned index; // Into the path queue
+	bool operator<(const ShadeItem& o) const { return material < o.material; }
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "geometry.h"
+#include "simd.h"
+#include "hit.h"
+
+//! Up to MaxSize coherent rays, stored as structure of arrays so they can be intersected with SIMD
+//! Lanes beyond size are padding and never report hits
+class RayPacket {
+public:
+	enum { MaxSize = 16 };
+
+	RayPacket() : size(0) {}
+
+	//! Stores ray in lane i and resets the closest hit of that lane
+	void SetRay(unsigned i, const Ray& ray) {
+		assert(i < MaxSize);
+		ox[i] = ray.o.x; oy[i] = ray.o.y; oz[i] = ray.o.z;
+		dx[i] = ray.d.x; dy[i] = ray.d.y; dz[i] = ray.d.z;
+		invdx[i] = 1.f / ray.d.x; invdy[i] = 1.f / ray.d.y; invdz[i] = 1.f / ray.d.z;
+		mint[i] = ray.mint;
+		time[i] = ray.time;
+		t[i] = ray.maxt;
+		shape[i] = NULL;
+		instance[i] = NULL;
+	}
+
+	Ray GetRay(unsigned i) const {
+		return Ray(Point(ox[i], oy[i], oz[i]), Vector(dx[i], dy[i], dz[i]), mint[i], INFINITY, time[i]);
+	}
+
+	//! Closest hit of lane i as traversal found it, see Hit::Complete
+	Hit GetHit(unsigned i) const {
+		Hit hit;
+		hit.t = t[i];
+		hit.b1 = b1[i];
+		hit.b2 = b2[i];
+		hit.shape = shape[i];
+		hit.instance = instance[i];
+		hit.primitive = primitive[i];
+		return hit;
+	}
+	void SetHit(unsigned i, const Hit& hit) {
+		t[i] = hit.t;
+		b1[i] = hit.b1;
+		b2[i] = hit.b2;
+		shape[i] = hit.shape;
+		instance[i] = hit.instance;
+		primitive[i] = hit.primitive;
+	}
+
+	//! Fills the unused lanes with copies of lane 0 that can never be hit
+	void Pad() {
+		assert(size > 0);
+		for (unsigned i = size; i < MaxSize; i++) {
+			ox[i] = ox[0]; oy[i] = oy[0]; oz[i] = oz[0];
+			dx[i] = dx[0]; dy[i] = dy[0]; dz[i] = dz[0];
+			invdx[i] = invdx[0]; invdy[i] = invdy[0]; invdz[i] = invdz[0];
+			mint[i] = mint[0];
+			time[i] = time[0];
+			t[i] = 0.f;
+			shape[i] = NULL;
+			instance[i] = NULL;
+		}
+	}
+
+	//! Bit i is set for every lane that holds a real ray
+	unsigned ValidMask() const { return (1u << size) - 1u; }
+
+	float ox[MaxSize], oy[MaxSize], oz[MaxSize]; // Origins
+	float dx[MaxSize], dy[MaxSize], dz[MaxSize]; // Directions
+	float invdx[MaxSize], invdy[MaxSize], invdz[MaxSize]; // Reciprocal directions for slab tests
+	float mint[MaxSize];
+	float time[MaxSize];
+	float t[MaxSize]; // Distance to the closest hit so far
+	float b1[MaxSize], b2[MaxSize]; // Barycentric coordinates of the closest hit
+	const Shape* shape[MaxSize]; // Closest shape hit so far, NULL if none
+	const Instance* instance[MaxSize]; // Instance the closest shape belongs to, NULL if it is not instanced
+	unsigned primitive[MaxSize]; // See Hit::primitive
+	unsigned size; // Number of lanes in use
+};
\ No newline at end of file
@@ -0,0 +1,398 @@
+#include "renderer.h"
+#include "sobolsampler.h"
+#include <algorithm>
+
+Renderer::Renderer(const World& world, Camera& camera, unsigned nThreads, unsigned tileSize)
+	: world(world), camera(camera), film(&camera.film), filmScale(1), cancelled(false), scheduler(nThreads),
+	tileSize(tileSize), packetWidth(4), packetHeight(4),
+	maxDepth(4), rouletteDepth(3), wavefront(false), motionBlur(false), adaptiveThreshold(0.f), minSamples(16) {
+	SetSampler(SobolSampler());
+	wavefrontBuffers.resize(scheduler.GetThreadCount());
+	filmTiles.resize(scheduler.GetThreadCount());
+	sampledPixels.resize(scheduler.GetThreadCount());
+}
+
+Renderer::~Renderer() {
+	for (unsigned i = 0; i < samplers.size(); i++)
+		delete samplers[i];
+}
+
+void Renderer::SetSampler(const Sampler& sampler) {
+	for (unsigned i = 0; i < samplers.size(); i++)
+		delete samplers[i];
+	samplers.clear();
+	for (unsigned i = 0; i < scheduler.GetThreadCount(); i++)
+		samplers.push_back(sampler.Clone());
+}
+
+void Renderer::SetPacketSize(unsigned size) {
+	assert(size == 1 || size == 4 || size == 8 || size == 16);
+	assert(size <= RayPacket::MaxSize);
+	packetWidth = size >= 8 ? 4 : (size == 4 ? 2 : 1);
+	packetHeight = size / packetWidth;
+}
+
+unsigned Renderer::RenderPass() {
+	return RenderPass(camera.film, 1);
+}
+
+unsigned Renderer::RenderPass(Film& film, unsigned scale) {
+	assert(film.GetWidth() * scale >= camera.film.GetWidth() && film.GetHeight() * scale >= camera.film.GetHeight());
+	this->film = &film;
+	filmScale = scale;
+	nTilesX = (film.GetWidth() + tileSize - 1) / tileSize;
+	nTilesY = (film.GetHeight() + tileSize - 1) / tileSize;
+	cancelled = false;
+	std::fill(sampledPixels.begin(), sampledPixels.end(), 0);
+	scheduler.Run(nTilesX * nTilesY, [this](unsigned tile, unsigned thread) {
+		if (!cancelled)
+			RenderTile(tile, thread);
+	});
+	unsigned total = 0;
+	for (unsigned i = 0; i < sampledPixels.size(); i++)
+		total += sampledPixels[i];
+	return total;
+}
+
+//! With adaptive sampling on, pixels stop getting samples once the error of their average is below the threshold
+bool Renderer::NeedsSample(unsigned x, unsigned y) const {
+	return adaptiveThreshold <= 0.f || film->GetSampleCount(x, y) < minSamples
+		|| film->GetRelativeError(x, y) > adaptiveThreshold;
+}
+
+void Renderer::RenderTile(unsigned tile, unsigned thread) {
+	Sampler& sampler = *samplers[thread];
+	Film& film = *this->film;
+	unsigned x0 = (tile % nTilesX) * tileSize;
+	unsigned y0 = (tile / nTilesX) * tileSize;
+	unsigned x1 = std::min(x0 + tileSize, film.GetWidth());
+	unsigned y1 = std::min(y0 + tileSize, film.GetHeight());
+	FilmTile& filmTile = filmTiles[thread];
+	filmTile.Reset(film, x0, y0, x1, y1);
+
+	unsigned sampled = 0;
+	if (wavefront) {
+		sampled = RenderTileWavefront(x0, y0, x1, y1, filmTile, wavefrontBuffers[thread], sampler);
+	}
+	else if (GetPacketSize() > 1) {
+		sampled = RenderTilePackets(x0, y0, x1, y1, filmTile, sampler);
+	}
+	else {
+		for (unsigned y = y0; y < y1; y++) {
+			for (unsigned x = x0; x < x1; x++) {
+				if (!NeedsSample(x, y)) continue;
+				float u1, u2;
+				Ray ray = GenerateCameraRay(x, y, sampler, u1, u2);
+				PixelFeatures features;
+				Color l = TraceRay(ray, sampler, features);
+				filmTile.AddSample(x, y, u1, u2, l, features);
+				sampled++;
+			}
+		}
+	}
+
+	// The film only learns about the samples once the whole tile is done, so the sample counts stay put meanwhile
+	if (sampled > 0)
+		film.MergeTile(filmTile);
+	sampledPixels[thread] += sampled;
+}
+
+//! Starts the next sample of pixel (x, y) and returns its camera ray
+//! The sample index is the number of samples the pixel already has
+//! u1 and u2 are set to the position of the sample within the pixel
+Ray Renderer::GenerateCameraRay(unsigned x, unsigned y, Sampler& sampler, float& u1, float& u2) const {
+	sampler.StartPixel(x, y, film->GetSampleCount(x, y));
+	sampler.Get2D(&u1, &u2);
+	float time = motionBlur ? sampler.Get1D() : 0.f;
+	float s = (float)filmScale;
+	return camera.GenerateRay(x * filmScale, y * filmScale, u1 * s, u2 * s, time);
+}
+
+//! Traces the camera rays of a tile in packets covering packetWidth x packetHeight pixels
+//! Only the primary hits are found with packets, the rest of every path is traced on its own
+//! Returns the number of pixels that got a sample
+unsigned Renderer::RenderTilePackets(unsigned x0, unsigned y0, unsigned x1, unsigned y1, FilmTile& filmTile, Sampler& sampler) {
+	const Film& film = *this->film;
+	RayPacket packet;
+	unsigned px[RayPacket::MaxSize], py[RayPacket::MaxSize]; // Pixel of every lane
+	float pu[RayPacket::MaxSize], pv[RayPacket::MaxSize]; // Position of the sample of every lane within its pixel
+	unsigned sampled = 0;
+	for (unsigned by = y0; by < y1; by += packetHeight) {
+		for (unsigned bx = x0; bx < x1; bx += packetWidth) {
+			unsigned bw = std::min(packetWidth, x1 - bx);
+			unsigned bh = std::min(packetHeight, y1 - by);
+			packet.size = 0;
+			for (unsigned i = 0; i < bw * bh; i++) {
+				unsigned x = bx + i % bw, y = by + i / bw;
+				if (!NeedsSample(x, y)) continue;
+				px[packet.size] = x;
+				py[packet.size] = y;
+				Ray ray = GenerateCameraRay(x, y, sampler, pu[packet.size], pv[packet.size]);
+				packet.SetRay(packet.size++, ray);
+			}
+			if (packet.size == 0) continue;
+
+			world.IntersectPacket(packet);
+
+			for (unsigned i = 0; i < packet.size; i++) {
+				sampler.StartPixel(px[i], py[i], film.GetSampleCount(px[i], py[i]));
+				Ray ray = packet.GetRay(i);
+				Hit hit = packet.GetHit(i);
+				if (hit.shape) hit.Complete(ray);
+				Color l = hit.shape ? TracePath(ray, hit, sampler) : Color(0.6f, 0.6f, 0.9f);
+				filmTile.AddSample(px[i], py[i], pu[i], pv[i], l, GetFeatures(ray, hit));
+			}
+			sampled += packet.size;
+		}
+	}
+	return sampled;
+}
+
+//! Renders a tile one bounce at a time instead of one path at a time
+//! Every bounce goes through the same stages for all paths of the tile:
+//! extend (find the closest hits), sort the hits by material, then shade them and spawn the next rays
+//! Returns the number of pixels that got a sample
+unsigned Renderer::RenderTileWavefront(unsigned x0, unsigned y0, unsigned x1, unsigned y1, FilmTile& filmTile, WavefrontBuffers& buffers, Sampler& sampler) {
+	const Film& film = *this->film;
+	unsigned width = x1 - x0, height = y1 - y0;
+	unsigned nPixels = width * height;
+	PathQueue* current = &buffers.queues[0];
+	PathQueue* next = &buffers.queues[1];
+	current->Reserve(tileSize * tileSize);
+	next->Reserve(tileSize * tileSize);
+	std::vector<Color>& radiance = buffers.radiance;
+	radiance.assign(nPixels, Color());
+	std::vector<unsigned char>& active = buffers.active;
+	active.assign(nPixels, 0);
+	std::vector<PixelFeatures>& features = buffers.features;
+	features.resize(nPixels);
+	std::vector<float>& offsets = buffers.offsets;
+	offsets.resize(2 * nPixels);
+	std::vector<ShadeItem>& order = buffers.order;
+
+	// Generate camera rays, block by block so that consecutive rays can form coherent packets
+	current->Clear();
+	for (unsigned by = 0; by < height; by += packetHeight) {
+		for (unsigned bx = 0; bx < width; bx += packetWidth) {
+			unsigned bw = std::min(packetWidth, width - bx);
+			unsigned bh = std::min(packetHeight, height - by);
+			for (unsigned i = 0; i < bw * bh; i++) {
+				unsigned x = bx + i % bw, y = by + i / bw;
+				if (!NeedsSample(x0 + x, y0 + y)) continue;
+				unsigned pixel = y * width + x;
+				active[pixel] = 1;
+				Ray ray = GenerateCameraRay(x0 + x, y0 + y, sampler, offsets[2 * pixel], offsets[2 * pixel + 1]);
+				current->Push(ray, pixel, Color(1.f, 1.f, 1.f), true, 0.f);
+			}
+		}
+	}
+	unsigned sampled = current->GetSize();
+
+	for (unsigned depth = 0; current->GetSize() > 0; depth++) {
+		Extend(*current, depth == 0 && GetPacketSize() > 1);
+		if (depth == 0) {
+			for (unsigned i = 0; i < current->GetSize(); i++) {
+				Ray ray = current->GetRay(i);
+				Hit hit = current->GetHit(i);
+				if (hit.shape) hit.Complete(ray);
+				features[current->pixel[i]] = GetFeatures(ray, hit);
+			}
+		}
+
+		// Misses pick up the background, hits are sorted by material
+		order.clear();
+		for (unsigned i = 0; i < current->GetSize(); i++) {
+			if (current->shape[i]) {
+				ShadeItem item = { current->shape[i]->material, i };
+				order.push_back(item);
+			}
+			else {
+				radiance[current->pixel[i]] += current->GetThroughput(i) * Color(0.6f, 0.6f, 0.9f);
+			}
+		}
+		std::sort(order.begin(), order.end());
+
+		// Shade and spawn the rays of the next bounce
+		next->Clear();
+		for (unsigned k = 0; k < order.size(); k++) {
+			unsigned i = order[k].index;
+			unsigned pixel = current->pixel[i];
+			unsigned x = x0 + pixel % width, y = y0 + pixel / width;
+			sampler.StartPixel(x, y, film.GetSampleCount(x, y));
+			Color throughput = current->GetThroughput(i);
+			bool specular = current->specular[i] != 0;
+			float pdf = current->pdf[i];
+			Ray ray = current->GetRay(i);
+			Hit hit = current->GetHit(i);
+			hit.Complete(ray);
+			Ray newRay;
+			bool goOn = Scatter(ray, hit, depth, specular, pdf, radiance[pixel], throughput, newRay, sampler);
+			if (goOn)
+				next->Push(newRay, pixel, throughput, specular, pdf);
+		}
+		std::swap(current, next);
+	}
+
+	for (unsigned y = 0; y < height; y++) {
+		for (unsigned x = 0; x < width; x++) {
+			unsigned pixel = y * width + x;
+			if (active[pixel])
+				filmTile.AddSample(x0 + x, y0 + y, offsets[2 * pixel], offsets[2 * pixel + 1], radiance[pixel], features[pixel]);
+		}
+	}
+	return sampled;
+}
+
+//! Finds the closest hit of every ray in the queue
+//! Coherent rays are intersected in packets, the others one by one
+void Renderer::Extend(PathQueue& queue, bool coherent) const {
+	unsigned n = queue.GetSize();
+	if (coherent) {
+		RayPacket packet;
+		unsigned packetSize = GetPacketSize();
+		for (unsigned first = 0; first < n; first += packetSize) {
+			packet.size = std::min(packetSize, n - first);
+			for (unsigned i = 0; i < packet.size; i++)
+				packet.SetRay(i, queue.GetRay(first + i));
+			world.IntersectPacket(packet);
+			for (unsigned i = 0; i < packet.size; i++)
+				queue.SetHit(first + i, packet.GetHit(i));
+		}
+		return;
+	}
+
+	// The surface at the hits is worked out when they are shaded, after sorting
+	for (unsigned i = 0; i < n; i++) {
+		Hit hit;
+		world.FindClosest(queue.GetRay(i), hit);
+		queue.SetHit(i, hit);
+	}
+}
+
+//! Weight of a sample taken with density pdf, when another strategy could have produced it with density otherPdf
+static float PowerHeuristic(float pdf, float otherPdf) {
+	float a = pdf * pdf, b = otherPdf * otherPdf;
+	return a + b > 0.f ? a / (a + b) : 0.f;
+}
+
+//! Light that reaches p straight from a light and is scattered by material towards wo
+//! One light is picked per call, a shadow ray checks that nothing is in between
+//! The result is weighted against finding the same light by sampling the material
+Color Renderer::SampleDirect(const Point& p, float time, const ShadingFrame& frame, const Vector& wo, const Material* material, Sampler& sampler) const {
+	float selectPdf;
+	const Shape* light = world.SampleLight(sampler.Get1D(), &selectPdf);
+	if (!light) return Color();
+
+	Normal ln;
+	float pdf;
+	float u1, u2;
+	sampler.Get2D(&u1, &u2);
+	Point lp = light->Sample(p, u1, u2, &ln, &pdf);
+	Vector wi = lp - p;
+	float distance = wi.Length();
+	if (pdf <= 0.f || distance == 0.f) return Color();
+	wi /= distance;
+	Vector wiLocal = frame.ToLocal(wi);
+	Color f = material->Eval(wo, wiLocal);
+	if (f.IsBlack()) return Color();
+
+	// The segment stops just short of the light so that it does not hit the light itself
+	Ray shadowRay(p, wi, 0.001f, distance * (1.f - 1e-3f), time);
+	if (world.Occluded(shadowRay))
+		return Color();
+
+	float lightPdf = pdf * selectPdf;
+	float weight = PowerHeuristic(lightPdf, material->Pdf(wo, wiLocal));
+	return f * light->material->emittance * (fabsf(wiLocal.z) * weight / lightPdf);
+}
+
+//! Features of the first hit of a camera ray, hit.shape is NULL if the ray hit nothing
+PixelFeatures Renderer::GetFeatures(const Ray& ray, const Hit& hit) const {
+	PixelFeatures features;
+	if (!hit.shape) {
+		features.albedo = Color(1.f, 1.f, 1.f);
+		features.depth = 0.f;
+		return features;
+	}
+	features.albedo = hit.material->GetAlbedo();
+	features.normal = hit.ns;
+	features.depth = hit.t * ray.d.Length();
+	return features;
+}
+
+//! Returns the light arriving at the origin of ray along it, and the features of what it hits first
+Color Renderer::TraceRay(const Ray& ray, Sampler& sampler, PixelFeatures& features) const {
+	Hit hit;
+	world.Intersect(ray, hit);
+	features = GetFeatures(ray, hit);
+	if (!hit.shape)
+		return Color(0.6f, 0.6f, 0.9f);
+	return TracePath(ray, hit, sampler);
+}
+
+//! Follows the path that starts with ray hitting the surface described by cameraHit
+//! Returns the light carried back along the path
+Color Renderer::TracePath(const Ray& cameraRay, const Hit& cameraHit, Sampler& sampler) const {
+	Color l(0.f, 0.f, 0.f);
+	Color throughput(1.f, 1.f, 1.f); // Fraction of the light at the current vertex that reaches the camera
+	Ray ray = cameraRay;
+	Hit hit = cameraHit;
+	bool specular = true; // Camera rays see emitters directly
+	float pdf = 0.f;
+	for (unsigned depth = 0; ; depth++) {
+		Ray newRay;
+		if (!Scatter(ray, hit, depth, specular, pdf, l, throughput, newRay, sampler))
+			break;
+
+		ray = newRay;
+		if (!world.Intersect(ray, hit)) {
+			l += throughput * Color(0.6f, 0.6f, 0.9f);
+			break;
+		}
+	}
+	return l;
+}
+
+//! Handles the path vertex where ray hit the surface described by hit after depth bounces
+//! Adds the light emitted and reflected there to l, and samples the material for the direction in which the path continues
+//! specular and pdf describe how ray was sampled at the previous vertex, specular is also set for camera rays
+//! Returns false if the path ends here, otherwise newRay is the next ray and throughput, specular and pdf have been updated for it
+bool Renderer::Scatter(const Ray& ray, const Hit& hit, unsigned depth,
+	bool& specular, float& pdf, Color& l, Color& throughput, Ray& newRay, Sampler& sampler) const {
+	const Material* material = hit.material;
+	const Point& p = hit.p;
+	Vector wo = -Normalize(ray.d);
+
+	// Emitters found by sampling a material could also have been found by SampleDirect at the previous vertex
+	if (!material->emittance.IsBlack()) {
+		float weight = 1.f;
+		if (!specular)
+			weight = PowerHeuristic(pdf, world.LightPdf(hit.shape) * hit.shape->Pdf(ray.o, p, hit.ng));
+		l += throughput * material->emittance * weight;
+	}
+	if (depth >= maxDepth) return false;
+
+	// Every bounce starts at its own dimension, whichever samples the previous bounces used
+	sampler.SetDimension(CameraDimensions + depth * BounceDimensions);
+	ShadingFrame frame(hit.ns);
+	Vector woLocal = frame.ToLocal(wo);
+	if (!material->IsSpecular())
+		l += throughput * SampleDirect(p, ray.time, frame, woLocal, material, sampler);
+
+	Vector wi;
+	float u1, u2;
+	sampler.Get2D(&u1, &u2);
+	Color f = material->Sample(woLocal, u1, u2, &wi, &pdf, &specular);
+	if (pdf <= 0.f || f.IsBlack()) return false;
+	throughput *= f * (fabsf(wi.z) / pdf);
+	newRay = Ray(p, frame.ToWorld(wi), 0.001f, INFINITY, ray.time);
+
+	// Russian roulette, paths that carry little light are likely to end here
+	// The ones that survive are weighted up to make up for the others
+	if (depth >= rouletteDepth) {
+		float survive = std::min(throughput.MaxComponent(), 0.95f);
+		if (sampler.Get1D() >= survive) return false;
+		throughput /= survive;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "world.h"
+#include "camera.h"
+#include "scheduler.h"
+#include "sampler.h"
+#include "pathqueue.h"
+#include <atomic>
+#include <vector>
+
+//! Traces paths through the world and accumulates them on the film of the camera
+//! The film is split into square tiles that are rendered in parallel
+class Renderer {
+public:
+	Renderer(const World& world, Camera& camera, unsigned nThreads, unsigned tileSize = 32);
+	~Renderer();
+
+	//! Adds one sample to every pixel of the film that still needs one
+	//! Returns the number of pixels sampled, 0 once adaptive sampling finds the whole film converged
+	unsigned RenderPass();
+	//! Renders a pass into film instead, where every pixel of film covers scale x scale pixels of the camera
+	//! film has to be at least the size of the camera film divided by scale, rounded up
+	unsigned RenderPass(Film& film, unsigned scale);
+	//! Skips the tiles of the current pass that have not started yet, can be called from any thread
+	//! The pass returns with the tiles done so far on the film, a pass that has not started yet is not affected
+	void CancelPass() { cancelled = true; }
+
+	//! Sampler that provides all random numbers, a Sobol sampler by default
+	void SetSampler(const Sampler& sampler);
+
+	unsigned GetThreadCount() const { return scheduler.GetThreadCount(); }
+
+	//! Number of primary rays traced together, 1 disables packets
+	void SetPacketSize(unsigned size);
+	unsigned GetPacketSize() const { return packetWidth * packetHeight; }
+
+	//! Number of bounces after which paths are cut off, paths end earlier through Russian roulette
+	void SetMaxDepth(unsigned depth) { maxDepth = depth; }
+	unsigned GetMaxDepth() const { return maxDepth; }
+
+	//! Traces all paths of a tile one bounce at a time instead of one path at a time
+	void SetWavefront(bool enable) { wavefront = enable; }
+	bool GetWavefront() const { return wavefront; }
+
+	//! Gives every camera ray a random time within the shutter interval, so that whatever moves during it is blurred
+	//! Without motion blur all rays are at time 0, when the shutter opens
+	void SetMotionBlur(bool enable) { motionBlur = enable; }
+	bool GetMotionBlur() const { return motionBlur; }
+
+	//! Stops sampling a pixel once it has minSamples samples and the relative error of its average is below threshold
+	//! A threshold of 0 turns adaptive sampling off, so every pass samples every pixel
+	void SetAdaptive(float threshold, unsigned minSamples = 16) { adaptiveThreshold = threshold; this->minSamples = minSamples; }
+	float GetAdaptiveThreshold() const { return adaptiveThreshold; }
+
+private:
+	//! Dimensions of the sampler that every path uses for the camera ray and for each bounce
+	//! The camera ray takes two for its position in the pixel and one for its time within the shutter interval
+	enum { CameraDimensions = 3, BounceDimensions = 6 };
+
+	//! Memory reused by every wavefront tile a thread renders
+	struct WavefrontBuffers {
+		PathQueue queues[2]; // Rays of the current and the next bounce
+		std::vector<Color> radiance; // Per pixel of the tile
+		std::vector<unsigned char> active; // 1 for the pixels of the tile that are sampled
+		std::vector<PixelFeatures> features; // Of the first hit in every pixel of the tile
+		std::vector<float> offsets; // Position of the sample within every pixel of the tile, two per pixel
+		std::vector<ShadeItem> order; // Hits of the current bounce, sorted by material
+	};
+
+	void RenderTile(unsigned tile, unsigned thread);
+	bool NeedsSample(unsigned x, unsigned y) const;
+	unsigned RenderTilePackets(unsigned x0, unsigned y0, unsigned x1, unsigned y1, FilmTile& filmTile, Sampler& sampler);
+	unsigned RenderTileWavefront(unsigned x0, unsigned y0, unsigned x1, unsigned y1, FilmTile& filmTile, WavefrontBuffers& buffers, Sampler& sampler);
+	void Extend(PathQueue& queue, bool coherent) const;
+	Ray GenerateCameraRay(unsigned x, unsigned y, Sampler& sampler, float& u1, float& u2) const;
+	PixelFeatures GetFeatures(const Ray& ray, const Hit& hit) const;
+	Color TraceRay(const Ray& ray, Sampler& sampler, PixelFeatures& features) const;
+	Color TracePath(const Ray& ray, const Hit& hit, Sampler& sampler) const;
+	bool Scatter(const Ray& ray, const Hit& hit, unsigned depth,
+		bool& specular, float& pdf, Color& l, Color& throughput, Ray& newRay, Sampler& sampler) const;
+	Color SampleDirect(const Point& p, float time, const ShadingFrame& frame, const Vector& wo, const Material* material, Sampler& sampler) const;
+
+	const World& world;
+	Camera& camera;
+	Film* film; // Film of the current pass
+	unsigned filmScale; // Camera pixels covered by a pixel of film along each axis
+	std::atomic<bool> cancelled;
+	Scheduler scheduler;
+	std::vector<Sampler*> samplers; // One per thread
+	std::vector<unsigned> sampledPixels; // Per thread, during a pass
+	unsigned tileSize;
+	unsigned nTilesX, nTilesY;
+	unsigned packetWidth, packetHeight; // Pixel block covered by one primary ray packet
+	unsigned maxDepth;
+	unsigned rouletteDepth; // Bounces before Russian roulette starts
+	bool wavefront;
+	bool motionBlur;
+	float adaptiveThreshold;
+	unsigned minSamples;
+	std::vector<WavefrontBuffers> wavefrontBuffers; // One per thread
+	std::vector<FilmTile> filmTiles; // One per thread, gathers the samples of a tile before they go to the film
+
+	// Not copyable, owns the samplers
+	Renderer(const Renderer&);
+	Renderer& operator=(const Renderer&);
+};
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "renderthread.h"
+#include <algorithm>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Coarsest preview, in camera pixels per preview pixel along each axis
+static const unsigned maxPreviewScale = 8;
+// Frame budgets without camera updates after which the camera counts as standing still
+static const float settleBudgets = 4.f;
+
+RenderThread::RenderThread(Renderer& renderer, Camera& camera, unsigned maxPasses)
+	: renderer(renderer), camera(camera), maxPasses(maxPasses), converged(false), reprojection(true),
+	frameBudget(0.f), throughput(0.f), previewScale(1), preview(1, 1), snapshotScale(1), snapshotPasses(0),
+	snapshotRequested(false), snapshotReady(false), passes(0), quit(false) {
+}
+
+RenderThread::~RenderThread() {
+	Stop();
+}
+
+void RenderThread::Start() {
+	assert(!thread.joinable());
+	quit = false;
+	thread = std::thread(&RenderThread::Loop, this);
+}
+
+void RenderThread::Stop() {
+	if (!thread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeUp.notify_all();
+	thread.join();
+}
+
+//! Four pixels and their weights that bilinearly interpolate an image
+struct Bilinear {
+	unsigned i[4];
+	float w[4];
+
+	template <typename T>
+	T operator()(const std::vector<T>& channel) const {
+		return channel[i[0]] * w[0] + channel[i[1]] * w[1] + channel[i[2]] * w[2] + channel[i[3]] * w[3];
+	}
+};
+
+//! Scales a preview up to width x height for display
+static void Upsample(const FilmImage& src, unsigned scale, unsigned width, unsigned height, FilmImage& dst) {
+	unsigned n = width * height;
+	dst.width = width;
+	dst.height = height;
+	dst.color.resize(n);
+	dst.albedo.resize(n);
+	dst.normal.resize(n);
+	dst.depth.resize(n);
+	dst.variance.resize(n);
+	dst.samples.resize(n);
+	for (unsigned y = 0; y < height; y++) {
+		float sy = std::min(std::max(((float)y + 0.5f) / (float)scale - 0.5f, 0.f), (float)(src.height - 1));
+		unsigned y0 = (unsigned)sy, y1 = std::min(y0 + 1, src.height - 1);
+		float fy = sy - (float)y0;
+		for (unsigned x = 0; x < width; x++) {
+			float sx = std::min(std::max(((float)x + 0.5f) / (float)scale - 0.5f, 0.f), (float)(src.width - 1));
+			unsigned x0 = (unsigned)sx, x1 = std::min(x0 + 1, src.width - 1);
+			float fx = sx - (float)x0;
+			Bilinear b = {
+				{ y0 * src.width + x0, y0 * src.width + x1, y1 * src.width + x0, y1 * src.width + x1 },
+				{ (1.f - fx) * (1.f - fy), fx * (1.f - fy), (1.f - fx) * fy, fx * fy }
+			};
+			unsigned i = y * width + x;
+			dst.color[i] = b(src.color);
+			dst.albedo[i] = b(src.albedo);
+			dst.normal[i] = b(src.normal);
+			dst.depth[i] = b(src.depth);
+			dst.variance[i] = b(src.variance);
+			dst.samples[i] = src.samples[(y / scale) * src.width + x / scale];
+		}
+	}
+}
+
+bool RenderThread::GetSnapshot(FilmImage& image, unsigned& nPasses) {
+	unsigned scale;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snapshotRequested = true;
+		if (!snapshotReady) return false;
+		// Hand over the buffer instead of copying it, the old one of the caller is reused next time
+		scale = snapshotScale;
+		if (scale > 1)
+			previewSnapshot.Swap(snapshot);
+		else
+			image.Swap(snapshot);
+		nPasses = snapshotPasses;
+		snapshotReady = false;
+	}
+	// Scaling a preview up is left to the caller, so that it does not hold up the next pass
+	if (scale > 1)
+		Upsample(previewSnapshot, scale, camera.film.GetWidth(), camera.film.GetHeight(), image);
+	return true;
+}
+
+void RenderThread::UpdateCamera(const std::function<void(Camera&)>& update) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		cameraUpdates.push_back(update);
+	}
+	// The pass in flight is for the old view, no need to finish it
+	renderer.CancelPass();
+	wakeUp.notify_all();
+}
+
+//! Smallest preview scale whose passes are expected to fit in the frame budget
+unsigned RenderThread::GetPreviewScale() const {
+	if (frameBudget <= 0.f) return 1;
+	if (throughput <= 0.f) return 4; // Nothing measured yet
+	float fullPass = (float)(camera.film.GetWidth() * camera.film.GetHeight()) / throughput;
+	unsigned scale = 1;
+	while (scale < maxPreviewScale && fullPass / (float)(scale * scale) > frameBudget)
+		scale *= 2;
+	return scale;
+}
+
+void RenderThread::Loop() {
+	std::vector<std::function<void(Camera&)> > updates;
+	Film& film = camera.film;
+	bool reproject = false;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			// Sleep once the film has all its passes, until the camera moves
+			// A preview keeps going, it still has to be refined
+			while (!quit && cameraUpdates.empty() && previewScale == 1 && (passes >= maxPasses || converged))
+				wakeUp.wait(lock);
+			if (quit) return;
+			updates.swap(cameraUpdates);
+		}
+
+		Clock::time_point start = Clock::now();
+		if (!updates.empty()) {
+			// Several moves in a row keep the history of the last full view that was rendered
+			if (reprojection && passes > 0 && previewScale == 1)
+				history.Capture(camera);
+			for (unsigned i = 0; i < updates.size(); i++)
+				updates[i](camera);
+			updates.clear();
+			passes = 0;
+			converged = false;
+			lastMove = start;
+			previewScale = GetPreviewScale();
+			if (previewScale > 1) {
+				preview.Resize((film.GetWidth() + previewScale - 1) / previewScale, (film.GetHeight() + previewScale - 1) / previewScale);
+			}
+			else {
+				film.Clear();
+				reproject = reprojection;
+			}
+		}
+		else if (previewScale > 1 && std::chrono::duration<float>(start - lastMove).count() > settleBudgets * frameBudget) {
+			// The camera stands still, refine at full resolution
+			previewScale = 1;
+			film.Clear();
+			passes = 0;
+			reproject = reprojection;
+		}
+
+		unsigned sampled = renderer.RenderPass(previewScale > 1 ? preview : film, previewScale);
+		float seconds = std::chrono::duration<float>(Clock::now() - start).count();
+		if (sampled > 0 && seconds > 0.f) {
+			float rate = (float)sampled / seconds;
+			throughput = throughput > 0.f ? 0.5f * (throughput + rate) : rate;
+		}
+		if (sampled == 0 && previewScale == 1)
+			converged = true;
+		// The first pass of the new view tells where every pixel looks, which is needed to find it in the old one
+		if (reproject) {
+			history.Reproject(camera);
+			reproject = false;
+		}
+		passes++;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (snapshotRequested && cameraUpdates.empty()) {
+			if (previewScale > 1)
+				preview.Resolve(snapshot);
+			else
+				film.Resolve(snapshot);
+			snapshotScale = previewScale;
+			snapshotPasses = passes;
+			snapshotReady = true;
+			snapshotRequested = false;
+		}
+	}
+}
\ No newline at end of file
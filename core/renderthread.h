@@ -0,0 +1,76 @@
+#pragma once
+
+#include "renderer.h"
+#include "camera.h"
+#include "history.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! Runs render passes back to back on a background thread, so the caller is free to display the film
+//! The film is only copied out between passes and only when asked for, so the tracer never waits on the display
+//! While the camera moves, passes go to a coarser preview film so that they fit in the frame budget,
+//! once it stands still the full film is rendered again
+class RenderThread {
+public:
+	RenderThread(Renderer& renderer, Camera& camera, unsigned maxPasses);
+	~RenderThread();
+
+	void Start();
+	void Stop();
+
+	//! Asks for a copy of the film at the end of the current pass
+	//! Returns true and fills in image and nPasses if a copy newer than the last one returned is available
+	bool GetSnapshot(FilmImage& image, unsigned& nPasses);
+
+	//! Changes the camera between two passes and starts over with a cleared film
+	//! With reprojection on, what the film had is carried over into the new view after its first pass
+	void UpdateCamera(const std::function<void(Camera&)>& update);
+	//! Only call this before Start
+	void SetReprojection(bool enable) { reprojection = enable; }
+	//! Time in seconds a pass may take while the camera moves, 0 always renders the full film
+	//! Only call this before Start
+	void SetFrameBudget(float seconds) { frameBudget = seconds; }
+
+	//! Number of passes in the film right now
+	unsigned GetPassCount() const { return passes; }
+
+private:
+	// Not copyable, the thread has a single owner
+	RenderThread(const RenderThread&);
+	RenderThread& operator=(const RenderThread&);
+
+	void Loop();
+	unsigned GetPreviewScale() const;
+
+	Renderer& renderer;
+	Camera& camera;
+	unsigned maxPasses;
+	bool converged; // Set when adaptive sampling finds nothing left to sample, only used by the thread itself
+	bool reprojection;
+	History history; // Only used by the thread itself
+
+	// Progressive preview, only used by the thread itself
+	float frameBudget;
+	float throughput; // Paths traced per second, measured over the last passes
+	unsigned previewScale; // Camera pixels per preview pixel along each axis, 1 when the full film is rendered
+	Film preview;
+	std::chrono::high_resolution_clock::time_point lastMove;
+	std::thread thread;
+
+	std::mutex mutex; // Guards everything below
+	std::condition_variable wakeUp;
+	std::vector<std::function<void(Camera&)> > cameraUpdates;
+	FilmImage snapshot; // Of the preview film while previewing
+	unsigned snapshotScale; // Preview scale of the snapshot, 1 for the full film
+	unsigned snapshotPasses;
+	bool snapshotRequested, snapshotReady;
+	std::atomic<unsigned> passes;
+	bool quit;
+
+	FilmImage previewSnapshot; // Only used by GetSnapshot, to scale previews up
+};
\ No newline at end of file
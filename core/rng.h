@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+//! Scrambles the bits of x, nearby inputs give unrelated outputs
+inline unsigned MixBits(unsigned x) {
+	x ^= x >> 16;
+	x *= 0x7feb352du;
+	x ^= x >> 15;
+	x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+
+//! Hash of a pair of numbers, used to derive seeds from pixel coordinates, sample indices and dimensions
+inline unsigned HashCombine(unsigned a, unsigned b) {
+	return MixBits(a ^ (MixBits(b) + 0x9e3779b9u + (a << 6) + (a >> 2)));
+}
+
+//! PCG32 random number generator, small and fast enough to be seeded for every sample
+class RNG {
+public:
+	explicit RNG(unsigned seed = 0) { Seed(seed); }
+
+	void Seed(unsigned seed, unsigned stream = 0) {
+		state = 0;
+		inc = ((uint64_t)stream << 1) | 1u;
+		UniformUInt();
+		state += seed;
+		UniformUInt();
+	}
+
+	//! Returns a uniformly distributed 32 bit number
+	unsigned UniformUInt() {
+		uint64_t old = state;
+		state = old * 6364136223846793005ull + inc;
+		unsigned shifted = (unsigned)(((old >> 18u) ^ old) >> 27u);
+		unsigned rot = (unsigned)(old >> 59u);
+		return (shifted >> rot) | (shifted << ((32u - rot) & 31u));
+	}
+
+	//! Returns a uniformly distributed number in [0, 1)
+	float Uniform() { return (float)(UniformUInt() >> 8) * (1.f / 16777216.f); }
+
+private:
+	uint64_t state;
+	uint64_t inc; // Selects one of 2^63 streams, must be odd
+};
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "rng.h"
+
+//! Produces the numbers in [0, 1) that drive the random decisions of a path
+//! A path asks for them one dimension at a time: the first two place the camera ray in the pixel, the third its time,
+//! each bounce then uses a fixed block of dimensions, see Renderer::Scatter
+//! The values only depend on the seed, the pixel, the sample index and the dimension,
+//! so a render comes out the same however its tiles are spread over threads
+class Sampler {
+public:
+	explicit Sampler(unsigned seed) : seed(seed), x(0), y(0), index(0), dimension(0) {}
+	virtual ~Sampler() {}
+
+	//! Starts sample number index of pixel (x, y) at dimension 0
+	virtual void StartPixel(unsigned px, unsigned py, unsigned sampleIndex) {
+		x = px;
+		y = py;
+		index = sampleIndex;
+		dimension = 0;
+	}
+
+	//! Continues the current sample at dimension d
+	virtual void SetDimension(unsigned d) { dimension = d; }
+
+	//! Returns the value of the next dimension
+	virtual float Get1D() = 0;
+	//! Returns the values of the next two dimensions, which are stratified together
+	virtual void Get2D(float* u1, float* u2) = 0;
+
+	//! New sampler of the same kind and seed, so every thread can have its own
+	virtual Sampler* Clone() const = 0;
+
+protected:
+	//! Seed that is different for every pixel and dimension, but the same for all sample indices
+	unsigned PixelSeed(unsigned d) const { return HashCombine(HashCombine(seed, d), HashCombine(x, y)); }
+
+	unsigned seed;
+	unsigned x, y;
+	unsigned index;
+	unsigned dimension;
+};
+
+//! Maps 32 random bits to a float in [0, 1)
+inline float BitsToFloat(unsigned bits) {
+	return (float)(bits >> 8) * (1.f / 16777216.f);
+}
\ No newline at end of file
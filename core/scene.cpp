@@ -0,0 +1,212 @@
+#include "scene.h"
+#include "lambert.h"
+#include "mirror.h"
+#include "glossy.h"
+#include "dielectric.h"
+#include "mappedfile.h"
+#include <algorithm>
+#include <unordered_map>
+
+Scene::~Scene() {
+	for (unsigned i = 0; i < meshes.size(); i++)
+		delete meshes[i];
+	for (unsigned i = 0; i < instances.size(); i++)
+		delete instances[i];
+	for (unsigned i = 0; i < instancedMeshes.size(); i++) {
+		delete instancedMeshes[i];
+		delete instancedMeshBuffers[i];
+	}
+	for (unsigned i = 0; i < materials.size(); i++)
+		delete materials[i];
+	// Only once nothing borrows from them any more, the world is destroyed after this body but does not read its arrays then
+	for (unsigned i = 0; i < files.size(); i++)
+		delete files[i];
+}
+
+unsigned Scene::AddMaterial(const MaterialDesc& desc) {
+	Material* material = NULL;
+	switch (desc.type) {
+	case MirrorMaterial: material = new Mirror(desc.color); break;
+	case GlossyMaterial: material = new Glossy(desc.color, desc.parameter); break;
+	case GlassMaterial: material = new Dielectric(desc.parameter, desc.color); break;
+	default: material = new Lambert(desc.color); break;
+	}
+	material->emittance = desc.emittance;
+	materialDescs.push_back(desc);
+	materials.push_back(material);
+	return (unsigned)materials.size() - 1;
+}
+
+void Scene::AddSphere(unsigned material, const Point& center, float radius) {
+	assert(material < materials.size());
+	Sphere sphere(materials[material]);
+	sphere.center = center;
+	sphere.radius = radius;
+	spheres.push_back(sphere);
+	sphereTracks.push_back(Track<Point>());
+}
+
+void Scene::AddTriangle(unsigned material, const Point& p1, const Point& p2, const Point& p3) {
+	assert(material < materials.size());
+	Triangle triangle(materials[material]);
+	triangle.p1 = p1;
+	triangle.p2 = p2;
+	triangle.p3 = p3;
+	triangles.push_back(triangle);
+}
+
+TriangleMesh* Scene::AddMesh(unsigned material) {
+	assert(material < materials.size());
+	meshes.push_back(new TriangleMesh(materials[material]));
+	return meshes.back();
+}
+
+TriangleMesh* Scene::AddInstancedMesh(unsigned material) {
+	assert(material < materials.size());
+	instancedMeshBuffers.push_back(new TriangleMesh(materials[material]));
+	instancedMeshes.push_back(new InstancedMesh(instancedMeshBuffers.back()));
+	return instancedMeshBuffers.back();
+}
+
+//! Builds the bottom level of the instanced mesh with its first instance
+void Scene::AddInstance(unsigned instancedMesh, const Transform& objectToWorld) {
+	assert(instancedMesh < instancedMeshes.size());
+	InstancedMesh* mesh = instancedMeshes[instancedMesh];
+	if (!mesh->IsBuilt())
+		mesh->Build();
+	instances.push_back(new Instance(mesh, objectToWorld));
+	instanceTracks.push_back(Track<std::vector<TransformStep> >());
+}
+
+void Scene::MoveInstance(unsigned i, const Transform& objectToWorld) {
+	assert(i < instances.size());
+	instances[i]->SetTransform(objectToWorld);
+	world.UpdateInstances();
+}
+
+void Scene::AddSphereKey(unsigned sphere, float time, const Point& center) {
+	assert(sphere < spheres.size());
+	sphereTracks[sphere].AddKey(time, center);
+}
+
+void Scene::AddInstanceKey(unsigned instance, float time, const std::vector<TransformStep>& steps) {
+	assert(instance < instances.size());
+	instanceTracks[instance].AddKey(time, steps);
+}
+
+void Scene::AddCameraKey(float time, const CameraKey& key) {
+	cameraTrack.AddKey(time, key);
+}
+
+bool Scene::IsAnimated() const {
+	if (!cameraTrack.IsEmpty()) return true;
+	for (unsigned i = 0; i < sphereTracks.size(); i++)
+		if (!sphereTracks[i].IsEmpty()) return true;
+	for (unsigned i = 0; i < instanceTracks.size(); i++)
+		if (!instanceTracks[i].IsEmpty()) return true;
+	return false;
+}
+
+//! Only refits, the hierarchy built for the first frame is kept
+void Scene::SetTime(float time, float shutter) {
+	bool spheresMoved = false;
+	for (unsigned i = 0; i < spheres.size(); i++) {
+		if (sphereTracks[i].IsEmpty()) continue;
+		spheres[i].center = sphereTracks[i].Evaluate(time);
+		spheresMoved = true;
+	}
+	for (unsigned i = 0; i < instances.size(); i++) {
+		if (instanceTracks[i].IsEmpty()) continue;
+		Transform start = Compose(instanceTracks[i].Evaluate(time));
+		instances[i]->SetTransform(start, shutter > 0.f ? Compose(instanceTracks[i].Evaluate(time + shutter)) : start);
+	}
+	world.Refit(spheresMoved);
+}
+
+unsigned Scene::GetInstancedMeshIndex(const InstancedMesh* mesh) const {
+	unsigned i = (unsigned)(std::find(instancedMeshes.begin(), instancedMeshes.end(), mesh) - instancedMeshes.begin());
+	assert(i < instancedMeshes.size());
+	return i;
+}
+
+unsigned Scene::GetMaterialIndex(const Material* material) const {
+	unsigned i = (unsigned)(std::find(materials.begin(), materials.end(), material) - materials.begin());
+	assert(i < materials.size());
+	return i;
+}
+
+//! Starts over with an empty world, so that Finalize can be called more than once
+void Scene::PopulateWorld() {
+	world = World();
+	for (unsigned i = 0; i < spheres.size(); i++)
+		world.AddShape(&spheres[i]);
+	for (unsigned i = 0; i < triangles.size(); i++)
+		world.AddShape(&triangles[i]);
+	for (unsigned i = 0; i < meshes.size(); i++)
+		world.AddMesh(meshes[i]);
+	for (unsigned i = 0; i < instances.size(); i++)
+		world.AddInstance(instances[i]);
+}
+
+void Scene::Finalize() {
+	PopulateWorld();
+	world.Finalize();
+}
+
+void Scene::Finalize(std::vector<LinearBVHNode>& nodes, const std::vector<unsigned>& primitives, const BVHArrays& arrays) {
+	PopulateWorld();
+	const std::vector<Shape*>& shapes = world.GetShapes();
+	std::vector<Shape*> ordered(primitives.size());
+	for (unsigned i = 0; i < primitives.size(); i++) {
+		assert(primitives[i] < shapes.size());
+		ordered[i] = shapes[primitives[i]];
+	}
+	world.GetBVH().Restore(nodes, ordered, arrays);
+	world.Finalize(false);
+}
+
+void Scene::KeepFile(MappedFile* file) {
+	files.push_back(file);
+}
+
+void Scene::GetBVHPrimitives(std::vector<unsigned>& primitives) const {
+	const std::vector<Shape*>& shapes = world.GetShapes();
+	std::unordered_map<const Shape*, unsigned> indices;
+	for (unsigned i = 0; i < shapes.size(); i++)
+		indices[shapes[i]] = i;
+	const std::vector<Shape*>& ordered = world.GetBVH().GetPrimitives();
+	primitives.resize(ordered.size());
+	for (unsigned i = 0; i < ordered.size(); i++)
+		primitives[i] = indices[ordered[i]];
+}
+
+//! The right vector follows from the direction and up, and up is made perpendicular to the direction
+static void SetView(CameraView& camera, const Point& position, const Vector& direction, const Vector& up) {
+	camera.position = position;
+	camera.direction = Normalize(direction);
+	camera.right = Normalize(Cross(up, camera.direction));
+	camera.up = Cross(camera.direction, camera.right);
+}
+
+void Scene::SetupCamera(CameraView& camera) const {
+	SetView(camera, settings.cameraPosition, settings.cameraDirection, settings.cameraUp);
+}
+
+void Scene::SetupCamera(Camera& camera, float time, float shutter) const {
+	if (cameraTrack.IsEmpty()) {
+		SetupCamera(camera);
+		camera.ClearMotion();
+		return;
+	}
+	CameraKey key = cameraTrack.Evaluate(time);
+	SetView(camera, key.position, key.direction, key.up);
+	if (shutter > 0.f) {
+		CameraView end;
+		key = cameraTrack.Evaluate(time + shutter);
+		SetView(end, key.position, key.direction, key.up);
+		camera.SetMotion(end);
+	}
+	else {
+		camera.ClearMotion();
+	}
+}
\ No newline at end of file
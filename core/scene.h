@@ -0,0 +1,138 @@
+#pragma once
+
+#include "world.h"
+#include "camera.h"
+#include "material.h"
+#include "sphere.h"
+#include "triangle.h"
+#include "trianglemesh.h"
+#include "instance.h"
+#include "animation.h"
+#include <string>
+#include <vector>
+
+class MappedFile;
+
+enum MaterialType { MatteMaterial, MirrorMaterial, GlossyMaterial, GlassMaterial };
+
+//! Parameters a material is created from
+struct MaterialDesc {
+	MaterialDesc() : type(MatteMaterial), color(1.f, 1.f, 1.f), parameter(0.f) {}
+
+	MaterialType type;
+	Color color;
+	float parameter; // Roughness of glossy materials, index of refraction of glass
+	Color emittance;
+};
+
+//! Camera and render settings of a scene, the command line can override them
+struct SceneSettings {
+	SceneSettings() : width(1280), height(720), samples(256), maxDepth(4), seed(0), exposure(0.f),
+		sampler("sobol"), filter("box"), tonemap("clamp"),
+		cameraPosition(0.f, 25.f, -25.f), cameraDirection(0.f, -1.f, 1.f), cameraUp(0.f, 1.f, 1.f),
+		frames(1), frameRate(24.f), shutter(0.f) {}
+
+	unsigned width, height;
+	unsigned samples; // Per pixel
+	unsigned maxDepth;
+	unsigned seed;
+	float exposure;
+	std::string sampler, filter, tonemap;
+	Point cameraPosition;
+	Vector cameraDirection, cameraUp; // Need not be normalized or perpendicular
+	unsigned frames; // Of the animation
+	float frameRate; // Frames per second
+	float shutter; // Time the shutter is open, as a fraction of the time between frames
+};
+
+//! All shapes and materials of a scene, with its settings
+//! Owns every object it creates, the world only refers to them
+class Scene {
+public:
+	Scene() {}
+	~Scene();
+
+	//! Returns the index that shapes refer to the material by
+	unsigned AddMaterial(const MaterialDesc& desc);
+	//! Shapes are only handed to the world by the next Finalize, which has to come before rendering again
+	void AddSphere(unsigned material, const Point& center, float radius);
+	void AddTriangle(unsigned material, const Point& p1, const Point& p2, const Point& p3);
+	//! Adds an empty mesh, its buffers have to be filled in before Finalize
+	TriangleMesh* AddMesh(unsigned material);
+	//! Adds an empty mesh that is only rendered where it is instanced, its index is GetInstancedMeshCount() - 1
+	//! Its buffers have to be filled in before the first instance is added
+	TriangleMesh* AddInstancedMesh(unsigned material);
+	//! Places a copy of an instanced mesh, sharing its triangles and BVH with all other copies
+	void AddInstance(unsigned instancedMesh, const Transform& objectToWorld);
+
+	//! Hands every shape to the world and prepares it for rendering, can be called again after adding more
+	void Finalize();
+	//! Same, but with a BVH restored from BVH::GetNodes, GetBVHPrimitives and BVH::GetArrays instead of building one
+	//! primitives are indices into the shapes of the world, which are all spheres, then all triangles, then all meshes
+	//! The arrays are borrowed, see BVH::Restore and KeepFile
+	void Finalize(std::vector<LinearBVHNode>& nodes, const std::vector<unsigned>& primitives, const BVHArrays& arrays);
+	//! Takes over a mapped file that the BVHs of the scene borrow arrays from, it stays open until the scene is destroyed
+	void KeepFile(MappedFile* file);
+	//! Indices of the shapes that the leaves of the BVH refer to, see Finalize
+	void GetBVHPrimitives(std::vector<unsigned>& primitives) const;
+	//! Moves instance i, only the top level of the world is rebuilt
+	void MoveInstance(unsigned i, const Transform& objectToWorld);
+
+	//! Keyframes, in seconds, that spheres, instances and the camera are animated with
+	//! Shapes without keys stay where they were added, the camera without keys stays where the settings say
+	void AddSphereKey(unsigned sphere, float time, const Point& center);
+	void AddInstanceKey(unsigned instance, float time, const std::vector<TransformStep>& steps);
+	void AddCameraKey(float time, const CameraKey& key);
+	bool IsAnimated() const;
+	//! Moves everything to where it is at time and refits the world
+	//! Instances move on to where they are at time + shutter during the shutter interval, spheres stand still
+	void SetTime(float time, float shutter);
+
+	//! Points the camera as the settings say
+	void SetupCamera(CameraView& camera) const;
+	//! Points the camera to where it is at time, moving on to where it is at time + shutter for motion blur
+	void SetupCamera(Camera& camera, float time, float shutter) const;
+
+	const std::vector<MaterialDesc>& GetMaterials() const { return materialDescs; }
+	unsigned GetSphereCount() const { return (unsigned)spheres.size(); }
+	const Sphere& GetSphere(unsigned i) const { return spheres[i]; }
+	unsigned GetTriangleCount() const { return (unsigned)triangles.size(); }
+	const Triangle& GetTriangle(unsigned i) const { return triangles[i]; }
+	unsigned GetMeshCount() const { return (unsigned)meshes.size(); }
+	const TriangleMesh& GetMesh(unsigned i) const { return *meshes[i]; }
+	unsigned GetInstancedMeshCount() const { return (unsigned)instancedMeshes.size(); }
+	const InstancedMesh& GetInstancedMesh(unsigned i) const { return *instancedMeshes[i]; }
+	InstancedMesh& GetInstancedMesh(unsigned i) { return *instancedMeshes[i]; }
+	unsigned GetInstanceCount() const { return (unsigned)instances.size(); }
+	const Instance& GetInstance(unsigned i) const { return *instances[i]; }
+	const Track<Point>& GetSphereTrack(unsigned i) const { return sphereTracks[i]; }
+	const Track<std::vector<TransformStep> >& GetInstanceTrack(unsigned i) const { return instanceTracks[i]; }
+	const Track<CameraKey>& GetCameraTrack() const { return cameraTrack; }
+	//! Index of the material of a shape or mesh of this scene
+	unsigned GetMaterialIndex(const Material* material) const;
+	unsigned GetInstancedMeshIndex(const InstancedMesh* mesh) const;
+
+	World world;
+	SceneSettings settings;
+
+private:
+	// Not copyable, owns its shapes and the world points to them
+	Scene(const Scene&);
+	Scene& operator=(const Scene&);
+
+	void PopulateWorld();
+
+	std::vector<MaterialDesc> materialDescs;
+	std::vector<Material*> materials; // Created from materialDescs
+	// Kept by value so that the shapes of a kind lie next to each other, the world points into these
+	std::vector<Sphere> spheres;
+	std::vector<Triangle> triangles;
+	std::vector<TriangleMesh*> meshes;
+	std::vector<TriangleMesh*> instancedMeshBuffers;
+	std::vector<InstancedMesh*> instancedMeshes; // Parallel to instancedMeshBuffers
+	std::vector<Instance*> instances;
+	std::vector<Track<Point> > sphereTracks; // Parallel to spheres
+	std::vector<Track<std::vector<TransformStep> > > instanceTracks; // Parallel to instances
+	Track<CameraKey> cameraTrack;
+	std::vector<MappedFile*> files; // See KeepFile
+};
\ No newline at end of file
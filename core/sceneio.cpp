@@ -0,0 +1,967 @@
+#include "sceneio.h"
+#include "meshio.h"
+#include "mappedfile.h"
+#include "simd.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(Transform) == 32 * sizeof(float), "The scene cache copies transforms as plain floats");
+static_assert(sizeof(TransformStep) == 5 * sizeof(float), "The scene cache copies transform steps as plain data");
+static_assert(sizeof(Point) == 3 * sizeof(float) && sizeof(Normal) == 3 * sizeof(float) && sizeof(Color) == 3 * sizeof(float),
+	"The scene cache copies points, normals and colors as plain floats");
+
+static const char cacheMagic[8] = { 'S', 'M', 'U', 'R', 'F', 'S', 'C', 'N' };
+static const unsigned cacheVersion = 6;
+
+//! 64-bit FNV-1a hash, identifies the scene text a cache was made from
+static unsigned long long Hash(const std::string& text) {
+	unsigned long long hash = 14695981039346656037ULL;
+	for (unsigned i = 0; i < text.size(); i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//! Size and modification time of a file, to tell whether a mesh changed since the cache was written
+struct FileStamp {
+	FileStamp() : size(0), time(0) {}
+	bool operator==(const FileStamp& o) const { return size == o.size && time == o.time; }
+
+	unsigned long long size;
+	long long time;
+};
+
+static bool GetFileStamp(const std::string& filename, FileStamp& stamp) {
+#ifdef _WIN32
+	struct __stat64 s;
+	if (_stat64(filename.c_str(), &s) != 0) return false;
+#else
+	struct stat s;
+	if (stat(filename.c_str(), &s) != 0) return false;
+#endif
+	stamp.size = (unsigned long long)s.st_size;
+	stamp.time = (long long)s.st_mtime;
+	return true;
+}
+
+// Text format
+
+//! Reads a point, vector or color, whichever T is, as three numbers
+template <typename T>
+static bool ReadTriple(std::istream& in, T& t) {
+	float a, b, c;
+	if (!(in >> a >> b >> c)) return false;
+	t = T(a, b, c);
+	return true;
+}
+
+//! Reading numbers from text never gives infinities or NaNs, so neither does a cache made from it
+static bool IsFinite(float v) {
+	return !isnan(v) && !isinf(v);
+}
+
+static bool IsFinite(const Point& p) {
+	return IsFinite(p.x) && IsFinite(p.y) && IsFinite(p.z);
+}
+
+//! Checks the parameter of the type, for materials parsed as well as cached
+static bool IsValidMaterial(const MaterialDesc& desc) {
+	switch (desc.type) {
+	case MatteMaterial: case MirrorMaterial: return true;
+	case GlossyMaterial: case GlassMaterial: return desc.parameter > 0.f && IsFinite(desc.parameter);
+	default: return false;
+	}
+}
+
+//! Loads a mesh file named relative to directory and adds it to meshFiles
+static bool ParseMeshFile(std::istream& in, const std::string& directory, TriangleMesh& mesh, std::vector<std::string>& meshFiles, std::string& error) {
+	std::string file;
+	if (!(in >> file)) {
+		error = "expected a file name";
+		return false;
+	}
+	if (file[0] != '/' && file[0] != '\\' && file.find(':') == std::string::npos)
+		file = directory + file;
+	if (!LoadMesh(file, mesh)) {
+		error = "could not load " + file;
+		return false;
+	}
+	meshFiles.push_back(file);
+	return true;
+}
+
+//! Reads translate, rotate and scale steps up to the end of the line
+static bool ParseTransformSteps(std::istream& in, std::vector<TransformStep>& steps, std::string& error) {
+	std::string operation;
+	while (in >> operation) {
+		Vector v;
+		float angle = 0.f;
+		if ((operation == "rotate" && !(in >> angle)) || !ReadTriple(in, v)) {
+			error = "invalid parameters for " + operation;
+			return false;
+		}
+		if (operation == "translate") {
+			steps.push_back(TransformStep(TransformStep::Translation, v));
+		}
+		else if (operation == "rotate" && v.LengthSquared() > 0.f) {
+			steps.push_back(TransformStep(TransformStep::Rotation, v, angle));
+		}
+		else if (operation == "scale" && v.x != 0.f && v.y != 0.f && v.z != 0.f) {
+			steps.push_back(TransformStep(TransformStep::Scaling, v));
+		}
+		else {
+			error = "invalid transform " + operation;
+			return false;
+		}
+	}
+	return true;
+}
+
+//! Whether keys of an instance can be interpolated into each other
+static bool HaveSameSteps(const std::vector<TransformStep>& a, const std::vector<TransformStep>& b) {
+	if (a.size() != b.size()) return false;
+	for (unsigned i = 0; i < a.size(); i++)
+		if (a[i].type != b[i].type) return false;
+	return true;
+}
+
+//! What the key statements that follow a statement animate
+enum KeyTarget { NoKeys, SphereKeys, InstanceKeys, CameraKeys };
+
+//! Names the statements of a scene file refer to, and what the last one added
+struct SceneNames {
+	SceneNames() : keyTarget(NoKeys), keyTime(0.f) {}
+
+	std::unordered_map<std::string, unsigned> materials;
+	std::unordered_map<std::string, unsigned> objects; // Instanced meshes
+	KeyTarget keyTarget;
+	float keyTime; // Of the last key, the statement itself is the key at time 0
+	std::vector<TransformStep> steps; // Of the last instance
+};
+
+//! Parses what follows the time of a key statement, for whatever the statement before it added
+//! The first key also adds that statement as the key at time 0
+static bool ParseKey(std::istream& in, Scene& scene, SceneNames& names, std::string& error) {
+	float time;
+	if (!(in >> time)) {
+		error = "expected a time";
+		return false;
+	}
+	if (names.keyTarget == NoKeys) {
+		error = "keys have to follow the sphere, light, instance or camera they animate";
+		return false;
+	}
+	if (time <= names.keyTime) {
+		error = "keys have to be in order of time, after time 0";
+		return false;
+	}
+	bool first = names.keyTime == 0.f;
+	if (names.keyTarget == SphereKeys) {
+		unsigned sphere = scene.GetSphereCount() - 1;
+		Point center;
+		if (!ReadTriple(in, center)) {
+			error = "expected a center";
+			return false;
+		}
+		if (first) scene.AddSphereKey(sphere, 0.f, scene.GetSphere(sphere).center);
+		scene.AddSphereKey(sphere, time, center);
+	}
+	else if (names.keyTarget == InstanceKeys) {
+		unsigned instance = scene.GetInstanceCount() - 1;
+		std::vector<TransformStep> steps;
+		if (!ParseTransformSteps(in, steps, error))
+			return false;
+		if (!HaveSameSteps(steps, names.steps)) {
+			error = "keys have to repeat the transforms of their instance, in the same order";
+			return false;
+		}
+		if (first) scene.AddInstanceKey(instance, 0.f, names.steps);
+		scene.AddInstanceKey(instance, time, steps);
+	}
+	else {
+		const SceneSettings& settings = scene.settings;
+		CameraKey key;
+		if (!ReadTriple(in, key.position) || !ReadTriple(in, key.direction) || !ReadTriple(in, key.up)) {
+			error = "expected a position, direction and up vector";
+			return false;
+		}
+		if (first) scene.AddCameraKey(0.f, CameraKey(settings.cameraPosition, settings.cameraDirection, settings.cameraUp));
+		scene.AddCameraKey(time, key);
+	}
+	names.keyTime = time;
+	return true;
+}
+
+//! Parses the statement in line, see sceneio.h
+//! Mesh files that were loaded are added to meshFiles
+static bool ParseStatement(const std::string& line, const std::string& directory, Scene& scene,
+	SceneNames& names, std::vector<std::string>& meshFiles, std::string& error) {
+	std::unordered_map<std::string, unsigned>& materials = names.materials;
+	std::istringstream in(line);
+	std::string keyword;
+	if (!(in >> keyword)) return true; // Blank line
+	SceneSettings& settings = scene.settings;
+	if (keyword == "key")
+		return ParseKey(in, scene, names, error);
+	names.keyTarget = NoKeys;
+	names.keyTime = 0.f;
+
+	if (keyword == "resolution") {
+		if (!(in >> settings.width >> settings.height) || settings.width == 0 || settings.height == 0) {
+			error = "expected a width and height";
+			return false;
+		}
+	}
+	else if (keyword == "samples") {
+		if (!(in >> settings.samples) || settings.samples == 0) {
+			error = "expected a number of samples";
+			return false;
+		}
+	}
+	else if (keyword == "depth") {
+		if (!(in >> settings.maxDepth)) {
+			error = "expected a path depth";
+			return false;
+		}
+	}
+	else if (keyword == "sampler") {
+		if (!(in >> settings.sampler)) {
+			error = "expected a sampler";
+			return false;
+		}
+		in >> settings.seed;
+	}
+	else if (keyword == "filter") {
+		if (!(in >> settings.filter)) {
+			error = "expected a filter";
+			return false;
+		}
+	}
+	else if (keyword == "tonemap") {
+		if (!(in >> settings.tonemap)) {
+			error = "expected a tonemap operator";
+			return false;
+		}
+		in >> settings.exposure;
+	}
+	else if (keyword == "camera") {
+		if (!ReadTriple(in, settings.cameraPosition) || !ReadTriple(in, settings.cameraDirection) || !ReadTriple(in, settings.cameraUp)) {
+			error = "expected a position, direction and up vector";
+			return false;
+		}
+		names.keyTarget = CameraKeys;
+	}
+	else if (keyword == "animation") {
+		if (!(in >> settings.frames >> settings.frameRate) || settings.frames == 0 || settings.frameRate <= 0.f) {
+			error = "expected a number of frames and frames per second";
+			return false;
+		}
+	}
+	else if (keyword == "shutter") {
+		if (!(in >> settings.shutter) || settings.shutter < 0.f || settings.shutter > 1.f) {
+			error = "expected a shutter time between 0 and 1";
+			return false;
+		}
+	}
+	else if (keyword == "material") {
+		std::string name, type;
+		if (!(in >> name >> type)) {
+			error = "expected a name and type";
+			return false;
+		}
+		MaterialDesc desc;
+		bool valid = true;
+		if (type == "matte") {
+			desc.type = MatteMaterial;
+			valid = ReadTriple(in, desc.color);
+		}
+		else if (type == "mirror") {
+			desc.type = MirrorMaterial;
+		}
+		else if (type == "glossy") {
+			desc.type = GlossyMaterial;
+			valid = ReadTriple(in, desc.color) && (in >> desc.parameter) && IsValidMaterial(desc);
+		}
+		else if (type == "glass") {
+			desc.type = GlassMaterial;
+			valid = (in >> desc.parameter) && IsValidMaterial(desc);
+		}
+		else {
+			error = "unknown material type " + type;
+			return false;
+		}
+		if (!valid) {
+			error = "invalid parameters for " + type;
+			return false;
+		}
+		// Optional color of mirrors and glass, then optional emission
+		std::string word;
+		while (in >> word) {
+			if (word == "emit") {
+				if (!ReadTriple(in, desc.emittance)) {
+					error = "expected an emitted color";
+					return false;
+				}
+			}
+			else if (desc.type == MirrorMaterial || desc.type == GlassMaterial) {
+				std::istringstream color(word);
+				float r, g, b;
+				if (!(color >> r) || !(in >> g >> b)) {
+					error = "unexpected " + word;
+					return false;
+				}
+				desc.color = Color(r, g, b);
+			}
+			else {
+				error = "unexpected " + word;
+				return false;
+			}
+		}
+		materials[name] = scene.AddMaterial(desc);
+	}
+	else if (keyword == "light") {
+		Point center;
+		float radius;
+		MaterialDesc desc;
+		desc.color = Color(0.f, 0.f, 0.f);
+		if (!ReadTriple(in, center) || !(in >> radius) || !ReadTriple(in, desc.emittance)) {
+			error = "expected a center, radius and emitted color";
+			return false;
+		}
+		scene.AddSphere(scene.AddMaterial(desc), center, radius);
+		names.keyTarget = SphereKeys;
+	}
+	else if (keyword == "instance") {
+		std::string name;
+		in >> name;
+		std::unordered_map<std::string, unsigned>::const_iterator object = names.objects.find(name);
+		if (object == names.objects.end()) {
+			error = "unknown object " + name;
+			return false;
+		}
+		names.steps.clear();
+		if (!ParseTransformSteps(in, names.steps, error))
+			return false;
+		scene.AddInstance(object->second, Compose(names.steps));
+		names.keyTarget = InstanceKeys;
+	}
+	else if (keyword == "sphere" || keyword == "triangle" || keyword == "mesh" || keyword == "object") {
+		std::string objectName;
+		if (keyword == "object" && !(in >> objectName)) {
+			error = "expected a name";
+			return false;
+		}
+		std::string name;
+		in >> name;
+		std::unordered_map<std::string, unsigned>::const_iterator material = materials.find(name);
+		if (material == materials.end()) {
+			error = "unknown material " + name;
+			return false;
+		}
+		if (keyword == "sphere") {
+			Point center;
+			float radius;
+			if (!ReadTriple(in, center) || !(in >> radius)) {
+				error = "expected a center and radius";
+				return false;
+			}
+			scene.AddSphere(material->second, center, radius);
+			names.keyTarget = SphereKeys;
+		}
+		else if (keyword == "triangle") {
+			Point p1, p2, p3;
+			if (!ReadTriple(in, p1) || !ReadTriple(in, p2) || !ReadTriple(in, p3)) {
+				error = "expected three points";
+				return false;
+			}
+			scene.AddTriangle(material->second, p1, p2, p3);
+		}
+		else if (keyword == "mesh") {
+			if (!ParseMeshFile(in, directory, *scene.AddMesh(material->second), meshFiles, error))
+				return false;
+		}
+		else {
+			if (!ParseMeshFile(in, directory, *scene.AddInstancedMesh(material->second), meshFiles, error))
+				return false;
+			names.objects[objectName] = scene.GetInstancedMeshCount() - 1;
+		}
+	}
+	else {
+		error = "unknown statement " + keyword;
+		return false;
+	}
+	return true;
+}
+
+static bool ParseScene(const std::string& filename, const std::string& text, Scene& scene, std::vector<std::string>& meshFiles) {
+	size_t slash = filename.find_last_of("/\\");
+	std::string directory = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+	SceneNames names;
+	std::istringstream in(text);
+	std::string line;
+	for (unsigned lineNumber = 1; std::getline(in, line); lineNumber++) {
+		size_t comment = line.find('#');
+		if (comment != std::string::npos) line.erase(comment);
+		std::string error;
+		if (!ParseStatement(line, directory, scene, names, meshFiles, error)) {
+			std::cerr << filename << ":" << lineNumber << ": " << error << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// Binary cache
+// Everything is stored in the byte order and layout of the machine that wrote it, the header rejects any other
+
+struct CacheHeader {
+	char magic[8];
+	unsigned version;
+	unsigned nodeSize; // sizeof(LinearBVHNode)
+	unsigned long long hash; // Of the scene text
+};
+
+//! Writes values and arrays of plain data back to back
+class CacheWriter {
+public:
+	explicit CacheWriter(const std::string& filename) : out(filename.c_str(), std::ios::binary) {}
+
+	bool IsGood() const { return out.good(); }
+
+	template <typename T>
+	void Write(const T& value) { out.write((const char*)&value, sizeof(T)); }
+	template <typename T>
+	void WriteArray(const std::vector<T>& values) {
+		Write((unsigned long long)values.size());
+		if (!values.empty()) out.write((const char*)&values[0], values.size() * sizeof(T));
+	}
+	//! Starts the values on a cache line of the file, so that they can be used in place where it is mapped, see CacheReader::BorrowArray
+	template <typename T>
+	void WriteAlignedArray(const T* values, unsigned n) {
+		Write((unsigned long long)n);
+		const unsigned alignment = AlignedArray<T>::Alignment;
+		static const char zeros[alignment] = { 0 };
+		out.write(zeros, (alignment - (unsigned)out.tellp() % alignment) % alignment);
+		if (n > 0) out.write((const char*)values, n * sizeof(T));
+	}
+	void WriteString(const std::string& s) {
+		Write((unsigned)s.size());
+		out.write(s.data(), s.size());
+	}
+
+private:
+	std::ofstream out;
+};
+
+//! Reads what CacheWriter wrote from a mapped file, every read checks that it stays inside the file
+class CacheReader {
+public:
+	CacheReader(const char* data, size_t size) : begin(data), p(data), end(data + size) {}
+
+	template <typename T>
+	bool Read(T& value) {
+		if ((size_t)(end - p) < sizeof(T)) return false;
+		memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+	//! Arrays are copied in one go
+	template <typename T>
+	bool ReadArray(std::vector<T>& values) {
+		unsigned long long n;
+		if (!Read(n) || n > (unsigned long long)(end - p) / sizeof(T)) return false;
+		values.resize((size_t)n);
+		if (n > 0) memcpy(&values[0], p, (size_t)n * sizeof(T));
+		p += (size_t)n * sizeof(T);
+		return true;
+	}
+	//! Points values into the file instead of copying, they are only valid while it stays mapped
+	//! Fails if the mapping does not start on a cache line, then the values would not either
+	template <typename T>
+	bool BorrowArray(const T*& values, unsigned& n) {
+		unsigned long long count;
+		const size_t alignment = AlignedArray<T>::Alignment;
+		if (!Read(count) || ((size_t)begin & (alignment - 1)) != 0) return false;
+		size_t padding = (alignment - (size_t)(p - begin) % alignment) % alignment;
+		if (padding > (size_t)(end - p) || count > (unsigned long long)(end - p - padding) / sizeof(T)) return false;
+		p += padding;
+		values = (const T*)p;
+		n = (unsigned)count;
+		p += (size_t)count * sizeof(T);
+		return true;
+	}
+	bool ReadString(std::string& s) {
+		unsigned n;
+		if (!Read(n) || n > (size_t)(end - p)) return false;
+		s.assign(p, n);
+		p += n;
+		return true;
+	}
+	bool AtEnd() const { return p == end; }
+
+private:
+	const char* begin;
+	const char* p;
+	const char* end;
+};
+
+//! Shapes of the scene as stored in the cache
+struct CachedSphere {
+	unsigned material;
+	Point center;
+	float radius;
+};
+
+struct CachedTriangle {
+	unsigned material;
+	Point p[3];
+};
+
+static void WriteSettings(CacheWriter& out, const SceneSettings& settings) {
+	out.Write(settings.width);
+	out.Write(settings.height);
+	out.Write(settings.samples);
+	out.Write(settings.maxDepth);
+	out.Write(settings.seed);
+	out.Write(settings.exposure);
+	out.WriteString(settings.sampler);
+	out.WriteString(settings.filter);
+	out.WriteString(settings.tonemap);
+	out.Write(settings.cameraPosition);
+	out.Write(settings.cameraDirection);
+	out.Write(settings.cameraUp);
+	out.Write(settings.frames);
+	out.Write(settings.frameRate);
+	out.Write(settings.shutter);
+}
+
+static bool ReadSettings(CacheReader& in, SceneSettings& settings) {
+	return in.Read(settings.width) && in.Read(settings.height) && in.Read(settings.samples) && in.Read(settings.maxDepth) &&
+		in.Read(settings.seed) && in.Read(settings.exposure) &&
+		in.ReadString(settings.sampler) && in.ReadString(settings.filter) && in.ReadString(settings.tonemap) &&
+		in.Read(settings.cameraPosition) && in.Read(settings.cameraDirection) && in.Read(settings.cameraUp) &&
+		in.Read(settings.frames) && in.Read(settings.frameRate) && in.Read(settings.shutter);
+}
+
+template <typename T>
+static void WriteTrack(CacheWriter& out, const Track<T>& track) {
+	out.WriteArray(track.GetTimes());
+	out.WriteArray(track.GetValues());
+}
+
+static void WriteTrack(CacheWriter& out, const Track<std::vector<TransformStep> >& track) {
+	out.WriteArray(track.GetTimes());
+	for (unsigned i = 0; i < track.GetValues().size(); i++)
+		out.WriteArray(track.GetValues()[i]);
+}
+
+//! Keys have to be in order of time
+static bool IsValidTrack(const std::vector<float>& times) {
+	for (unsigned i = 1; i < times.size(); i++)
+		if (!(times[i] > times[i - 1])) return false;
+	return true;
+}
+
+template <typename T>
+static bool ReadTrack(CacheReader& in, Track<T>& track) {
+	std::vector<float> times;
+	std::vector<T> values;
+	if (!in.ReadArray(times) || !in.ReadArray(values) || values.size() != times.size() || !IsValidTrack(times))
+		return false;
+	for (unsigned i = 0; i < times.size(); i++)
+		track.AddKey(times[i], values[i]);
+	return true;
+}
+
+//! Also checks that every key has the same steps
+static bool ReadTrack(CacheReader& in, Track<std::vector<TransformStep> >& track) {
+	std::vector<float> times;
+	if (!in.ReadArray(times) || !IsValidTrack(times))
+		return false;
+	std::vector<std::vector<TransformStep> > values(times.size());
+	for (unsigned i = 0; i < times.size(); i++) {
+		if (!in.ReadArray(values[i]) || !HaveSameSteps(values[i], values[0])) return false;
+		for (unsigned j = 0; j < values[i].size(); j++)
+			if (values[i][j].type > TransformStep::Scaling) return false;
+	}
+	for (unsigned i = 0; i < times.size(); i++)
+		track.AddKey(times[i], values[i]);
+	return true;
+}
+
+static void WriteMesh(CacheWriter& out, const TriangleMesh& mesh) {
+	out.WriteArray(mesh.positions);
+	out.WriteArray(mesh.normals);
+	out.WriteArray(mesh.uvs);
+	out.WriteArray(mesh.indices);
+}
+
+//! Also checks that the buffers fit together
+static bool ReadMesh(CacheReader& in, TriangleMesh& mesh) {
+	if (!in.ReadArray(mesh.positions) || !in.ReadArray(mesh.normals) || !in.ReadArray(mesh.uvs) || !in.ReadArray(mesh.indices))
+		return false;
+	for (unsigned j = 0; j < mesh.indices.size(); j++)
+		if (mesh.indices[j] >= mesh.positions.size()) return false;
+	for (unsigned j = 0; j < mesh.positions.size(); j++)
+		if (!IsFinite(mesh.positions[j])) return false;
+	return mesh.indices.size() % 3 == 0 && (mesh.normals.empty() || mesh.normals.size() == mesh.positions.size()) &&
+		(mesh.uvs.empty() || mesh.uvs.size() == 2 * mesh.positions.size());
+}
+
+//! Hands the buffers of src over to dst
+static void SwapMesh(TriangleMesh& src, TriangleMesh& dst) {
+	dst.positions.swap(src.positions);
+	dst.normals.swap(src.normals);
+	dst.uvs.swap(src.uvs);
+	dst.indices.swap(src.indices);
+}
+
+static void WriteBVHArrays(CacheWriter& out, const BVH& bvh) {
+	BVHArrays arrays;
+	bvh.GetArrays(arrays);
+	out.WriteAlignedArray(arrays.wideNodes, arrays.nWideNodes);
+	for (unsigned i = 0; i < SphereSoA::Arrays; i++)
+		out.WriteAlignedArray(arrays.spheres[i], arrays.sphereArraySize);
+	for (unsigned i = 0; i < TriangleSoA::Arrays; i++)
+		out.WriteAlignedArray(arrays.triangles[i], arrays.triangleArraySize);
+}
+
+//! The arrays point into the mapped file, whether they fit the hierarchy is up to IsValidBVH
+static bool ReadBVHArrays(CacheReader& in, BVHArrays& arrays) {
+	if (!in.BorrowArray(arrays.wideNodes, arrays.nWideNodes)) return false;
+	for (unsigned i = 0; i < SphereSoA::Arrays; i++) {
+		unsigned size;
+		if (!in.BorrowArray(arrays.spheres[i], size) || (i > 0 && size != arrays.sphereArraySize)) return false;
+		arrays.sphereArraySize = size;
+	}
+	for (unsigned i = 0; i < TriangleSoA::Arrays; i++) {
+		unsigned size;
+		if (!in.BorrowArray(arrays.triangles[i], size) || (i > 0 && size != arrays.triangleArraySize)) return false;
+		arrays.triangleArraySize = size;
+	}
+	return true;
+}
+
+//! Bottom level of an instanced mesh as stored in the cache
+struct CachedInstancedMesh {
+	unsigned material;
+	TriangleMesh mesh;
+	std::vector<LinearBVHNode> nodes;
+	std::vector<unsigned> triangles;
+	BVHArrays arrays;
+};
+
+struct CachedInstance {
+	unsigned instancedMesh;
+	Transform objectToWorld;
+};
+
+static bool WriteCache(const std::string& filename, unsigned long long hash, const std::vector<std::string>& meshFiles, const Scene& scene) {
+	CacheWriter out(filename);
+	CacheHeader header;
+	memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+	header.version = cacheVersion;
+	header.nodeSize = sizeof(LinearBVHNode);
+	header.hash = hash;
+	out.Write(header);
+
+	out.Write((unsigned)meshFiles.size());
+	for (unsigned i = 0; i < meshFiles.size(); i++) {
+		FileStamp stamp;
+		if (!GetFileStamp(meshFiles[i], stamp)) return false;
+		out.WriteString(meshFiles[i]);
+		out.Write(stamp);
+	}
+
+	WriteSettings(out, scene.settings);
+	out.WriteArray(scene.GetMaterials());
+
+	std::vector<CachedSphere> spheres(scene.GetSphereCount());
+	for (unsigned i = 0; i < spheres.size(); i++) {
+		const Sphere& sphere = scene.GetSphere(i);
+		spheres[i].material = scene.GetMaterialIndex(sphere.material);
+		spheres[i].center = sphere.center;
+		spheres[i].radius = sphere.radius;
+	}
+	out.WriteArray(spheres);
+	std::vector<CachedTriangle> triangles(scene.GetTriangleCount());
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		const Triangle& triangle = scene.GetTriangle(i);
+		triangles[i].material = scene.GetMaterialIndex(triangle.material);
+		triangles[i].p[0] = triangle.p1;
+		triangles[i].p[1] = triangle.p2;
+		triangles[i].p[2] = triangle.p3;
+	}
+	out.WriteArray(triangles);
+	out.Write(scene.GetMeshCount());
+	for (unsigned i = 0; i < scene.GetMeshCount(); i++) {
+		const TriangleMesh& mesh = scene.GetMesh(i);
+		out.Write(scene.GetMaterialIndex(mesh.material));
+		WriteMesh(out, mesh);
+	}
+	out.Write(scene.GetInstancedMeshCount());
+	for (unsigned i = 0; i < scene.GetInstancedMeshCount(); i++) {
+		const InstancedMesh& instancedMesh = scene.GetInstancedMesh(i);
+		out.Write(scene.GetMaterialIndex(instancedMesh.GetMesh()->material));
+		WriteMesh(out, *instancedMesh.GetMesh());
+		std::vector<unsigned> triangles;
+		instancedMesh.GetBVHTriangles(triangles);
+		out.WriteArray(instancedMesh.GetBVH().GetNodes());
+		out.WriteArray(triangles);
+		WriteBVHArrays(out, instancedMesh.GetBVH());
+	}
+	std::vector<CachedInstance> instances(scene.GetInstanceCount());
+	for (unsigned i = 0; i < instances.size(); i++) {
+		const Instance& instance = scene.GetInstance(i);
+		instances[i].instancedMesh = scene.GetInstancedMeshIndex(instance.GetInstancedMesh());
+		instances[i].objectToWorld = instance.GetTransform();
+	}
+	out.WriteArray(instances);
+	for (unsigned i = 0; i < scene.GetSphereCount(); i++)
+		WriteTrack(out, scene.GetSphereTrack(i));
+	for (unsigned i = 0; i < scene.GetInstanceCount(); i++)
+		WriteTrack(out, scene.GetInstanceTrack(i));
+	WriteTrack(out, scene.GetCameraTrack());
+
+	std::vector<unsigned> primitives;
+	scene.GetBVHPrimitives(primitives);
+	out.WriteArray(scene.world.GetBVH().GetNodes());
+	out.WriteArray(primitives);
+	WriteBVHArrays(out, scene.world.GetBVH());
+	return out.IsGood();
+}
+
+//! Kind of shape i of a world, whose shapes are nSpheres spheres followed by triangles
+static PrimitiveKind GetCachedKind(unsigned i, unsigned nSpheres) {
+	return i < nSpheres ? SpherePrimitive : TrianglePrimitive;
+}
+
+//! Checks that the wide nodes only refer to nodes after their own, so that there are no cycles,
+//! and to primitives of the kind the leaf says, kindStart is as in BVH
+//! Also checks that no node lies so deep that the traversal stack could overflow, see BVH::WideStackSize
+static bool IsValidWideBVH(const BVHArrays& arrays, const unsigned* kindStart) {
+	const unsigned width = WideBVHNode::Width;
+	std::vector<unsigned> depth(arrays.nWideNodes, 0);
+	for (unsigned i = 0; i < arrays.nWideNodes; i++) {
+		if (depth[i] * (width - 1) + width > BVH::WideStackSize) return false;
+		const WideBVHNode& node = arrays.wideNodes[i];
+		for (unsigned j = 0; j < width; j++) {
+			unsigned child = node.child[j], kind = node.kind[j];
+			if (node.nPrimitives[j] > 0) {
+				if (kind >= PrimitiveKinds || child < kindStart[kind] || child + node.nPrimitives[j] > kindStart[kind + 1]) return false;
+			}
+			else if (child != 0) {
+				if (child <= i || child >= arrays.nWideNodes) return false;
+				depth[child] = std::max(depth[child], depth[i] + 1);
+			}
+		}
+	}
+	return true;
+}
+
+//! Checks that every node only refers to nodes and primitives that exist, that every shape is in exactly one leaf,
+//! that the leaves hold the kind of shape they say in the order BVH::Restore expects, that arrays fit,
+//! and that the tree is not deeper than the traversal stacks, see BVH::StackSize
+static bool IsValidBVH(const std::vector<LinearBVHNode>& nodes, const std::vector<unsigned>& primitives, const BVHArrays& arrays,
+	unsigned nShapes, unsigned nSpheres) {
+	if (primitives.size() != nShapes || nodes.empty() != (nShapes == 0)) return false;
+	std::vector<bool> seen(nShapes, false);
+	for (unsigned i = 0; i < primitives.size(); i++) {
+		if (primitives[i] >= nShapes || seen[primitives[i]]) return false;
+		seen[primitives[i]] = true;
+		if (i > 0 && GetCachedKind(primitives[i], nSpheres) < GetCachedKind(primitives[i - 1], nSpheres)) return false;
+	}
+	// Children come after their parent, so the depth of every node is known by the time it is reached
+	std::vector<unsigned> depth(nodes.size(), 0);
+	for (unsigned i = 0; i < nodes.size(); i++) {
+		const LinearBVHNode& node = nodes[i];
+		if (node.nPrimitives > 0) {
+			if (node.primitivesOffset + node.nPrimitives > primitives.size()) return false;
+			for (unsigned j = node.primitivesOffset; j < node.primitivesOffset + node.nPrimitives; j++)
+				if (GetCachedKind(primitives[j], nSpheres) != node.kind) return false;
+			continue;
+		}
+		if (node.axis >= 3 || node.secondChildOffset <= i + 1 || node.secondChildOffset >= nodes.size() || depth[i] >= BVH::StackSize)
+			return false;
+		depth[i + 1] = std::max(depth[i + 1], depth[i] + 1);
+		depth[node.secondChildOffset] = std::max(depth[node.secondChildOffset], depth[i] + 1);
+	}
+
+	// Padded as SphereSoA::Resize and TriangleSoA::Resize pad, which differs between builds with other SIMD widths
+	unsigned nTriangles = nShapes - nSpheres;
+	unsigned kindStart[PrimitiveKinds + 1] = { 0, nSpheres, nShapes, nShapes };
+	return arrays.sphereArraySize == (nSpheres > 0 ? nSpheres + SIMD_WIDTH : 0) &&
+		arrays.triangleArraySize == (nTriangles > 0 ? nTriangles + SIMD_WIDTH : 0) &&
+		(arrays.nWideNodes > 0) == !nodes.empty() && IsValidWideBVH(arrays, kindStart);
+}
+
+//! Fills in scene from the mapped cache if it was made from the same scene text and meshes
+//! The BVHs use their wide nodes and sphere and triangle arrays where they lie in file, which has to stay mapped as long as the scene
+//! Everything else is copied into the scene, which owns and may change it
+//! Leaves scene untouched when it returns false
+static bool ReadCache(const MappedFile& file, unsigned long long hash, Scene& scene) {
+	CacheReader in(file.GetData(), file.GetSize());
+
+	CacheHeader header;
+	if (!in.Read(header) || memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion ||
+		header.nodeSize != sizeof(LinearBVHNode) || header.hash != hash)
+		return false;
+
+	unsigned nMeshFiles;
+	if (!in.Read(nMeshFiles)) return false;
+	for (unsigned i = 0; i < nMeshFiles; i++) {
+		std::string meshFile;
+		FileStamp cached, current;
+		if (!in.ReadString(meshFile) || !in.Read(cached) || !GetFileStamp(meshFile, current) || !(cached == current))
+			return false;
+	}
+
+	// Read everything before touching the scene, so a truncated file changes nothing
+	SceneSettings settings;
+	std::vector<MaterialDesc> materials;
+	std::vector<CachedSphere> spheres;
+	std::vector<CachedTriangle> triangles;
+	unsigned nMeshes;
+	if (!ReadSettings(in, settings) || !in.ReadArray(materials) || !in.ReadArray(spheres) || !in.ReadArray(triangles) ||
+		!in.Read(nMeshes) || nMeshes > file.GetSize())
+		return false;
+	unsigned nShapes = (unsigned)(spheres.size() + triangles.size());
+	std::vector<unsigned> meshMaterials(nMeshes);
+	std::vector<TriangleMesh> meshes(nMeshes);
+	for (unsigned i = 0; i < nMeshes; i++) {
+		if (!in.Read(meshMaterials[i]) || !ReadMesh(in, meshes[i]) || meshMaterials[i] >= materials.size())
+			return false;
+		nShapes += meshes[i].GetTriangleCount();
+	}
+	unsigned nInstancedMeshes;
+	if (!in.Read(nInstancedMeshes) || nInstancedMeshes > file.GetSize())
+		return false;
+	std::vector<CachedInstancedMesh> instancedMeshes(nInstancedMeshes);
+	for (unsigned i = 0; i < nInstancedMeshes; i++) {
+		CachedInstancedMesh& cached = instancedMeshes[i];
+		if (!in.Read(cached.material) || !ReadMesh(in, cached.mesh) || cached.material >= materials.size() ||
+			!in.ReadArray(cached.nodes) || !in.ReadArray(cached.triangles) || !ReadBVHArrays(in, cached.arrays) ||
+			!IsValidBVH(cached.nodes, cached.triangles, cached.arrays, cached.mesh.GetTriangleCount(), 0))
+			return false;
+	}
+	std::vector<CachedInstance> instances;
+	if (!in.ReadArray(instances))
+		return false;
+	for (unsigned i = 0; i < instances.size(); i++)
+		if (instances[i].instancedMesh >= nInstancedMeshes) return false;
+	std::vector<Track<Point> > sphereTracks(spheres.size());
+	for (unsigned i = 0; i < spheres.size(); i++)
+		if (!ReadTrack(in, sphereTracks[i])) return false;
+	std::vector<Track<std::vector<TransformStep> > > instanceTracks(instances.size());
+	for (unsigned i = 0; i < instances.size(); i++)
+		if (!ReadTrack(in, instanceTracks[i])) return false;
+	Track<CameraKey> cameraTrack;
+	if (!ReadTrack(in, cameraTrack))
+		return false;
+	std::vector<LinearBVHNode> nodes;
+	std::vector<unsigned> primitives;
+	BVHArrays arrays;
+	if (!in.ReadArray(nodes) || !in.ReadArray(primitives) || !ReadBVHArrays(in, arrays) || !in.AtEnd() ||
+		!IsValidBVH(nodes, primitives, arrays, nShapes, (unsigned)spheres.size()))
+		return false;
+	for (unsigned i = 0; i < materials.size(); i++)
+		if (!IsValidMaterial(materials[i])) return false;
+	for (unsigned i = 0; i < spheres.size(); i++)
+		if (spheres[i].material >= materials.size() || !IsFinite(spheres[i].center) || !IsFinite(spheres[i].radius)) return false;
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		const CachedTriangle& triangle = triangles[i];
+		if (triangle.material >= materials.size() || !IsFinite(triangle.p[0]) || !IsFinite(triangle.p[1]) || !IsFinite(triangle.p[2]))
+			return false;
+	}
+	// Hits get their normals from the shapes, which have to be where the arrays say they are
+	// Spheres come first among the primitives and then triangles, IsValidBVH made sure of that
+	// Mesh triangles are too many to compare, they are left to the checks of their buffers
+	for (unsigned i = 0; i < spheres.size(); i++) {
+		const CachedSphere& sphere = spheres[primitives[i]];
+		if (arrays.spheres[0][i] != sphere.center.x || arrays.spheres[1][i] != sphere.center.y || arrays.spheres[2][i] != sphere.center.z ||
+			arrays.spheres[3][i] != sphere.radius * sphere.radius)
+			return false;
+	}
+	unsigned nSpheres = (unsigned)spheres.size();
+	for (unsigned i = 0; i < nShapes - nSpheres; i++) {
+		unsigned shape = primitives[nSpheres + i];
+		if (shape >= nSpheres + triangles.size()) continue;
+		const CachedTriangle& triangle = triangles[shape - nSpheres];
+		// Computed as TriangleSoA::Set computes them
+		Vector e1 = triangle.p[1] - triangle.p[0], e2 = triangle.p[2] - triangle.p[0];
+		const float expected[TriangleSoA::Arrays] = { triangle.p[0].x, triangle.p[0].y, triangle.p[0].z, e1.x, e1.y, e1.z, e2.x, e2.y, e2.z };
+		for (unsigned j = 0; j < TriangleSoA::Arrays; j++)
+			if (arrays.triangles[j][i] != expected[j]) return false;
+	}
+
+	scene.settings = settings;
+	unsigned firstMaterial = (unsigned)scene.GetMaterials().size();
+	for (unsigned i = 0; i < materials.size(); i++)
+		scene.AddMaterial(materials[i]);
+	unsigned firstSphere = scene.GetSphereCount();
+	for (unsigned i = 0; i < spheres.size(); i++) {
+		scene.AddSphere(firstMaterial + spheres[i].material, spheres[i].center, spheres[i].radius);
+		for (unsigned j = 0; j < sphereTracks[i].GetTimes().size(); j++)
+			scene.AddSphereKey(firstSphere + i, sphereTracks[i].GetTimes()[j], sphereTracks[i].GetValues()[j]);
+	}
+	for (unsigned i = 0; i < triangles.size(); i++)
+		scene.AddTriangle(firstMaterial + triangles[i].material, triangles[i].p[0], triangles[i].p[1], triangles[i].p[2]);
+	for (unsigned i = 0; i < nMeshes; i++) {
+		TriangleMesh* mesh = scene.AddMesh(firstMaterial + meshMaterials[i]);
+		SwapMesh(meshes[i], *mesh);
+	}
+	unsigned firstInstancedMesh = scene.GetInstancedMeshCount();
+	for (unsigned i = 0; i < nInstancedMeshes; i++) {
+		SwapMesh(instancedMeshes[i].mesh, *scene.AddInstancedMesh(firstMaterial + instancedMeshes[i].material));
+		// Restored before the first instance is added, so that it is not built again
+		InstancedMesh& instancedMesh = scene.GetInstancedMesh(firstInstancedMesh + i);
+		if (!instancedMeshes[i].nodes.empty())
+			instancedMesh.Restore(instancedMeshes[i].nodes, instancedMeshes[i].triangles, instancedMeshes[i].arrays);
+	}
+	unsigned firstInstance = scene.GetInstanceCount();
+	for (unsigned i = 0; i < instances.size(); i++) {
+		scene.AddInstance(firstInstancedMesh + instances[i].instancedMesh, instances[i].objectToWorld);
+		for (unsigned j = 0; j < instanceTracks[i].GetTimes().size(); j++)
+			scene.AddInstanceKey(firstInstance + i, instanceTracks[i].GetTimes()[j], instanceTracks[i].GetValues()[j]);
+	}
+	for (unsigned i = 0; i < cameraTrack.GetTimes().size(); i++)
+		scene.AddCameraKey(cameraTrack.GetTimes()[i], cameraTrack.GetValues()[i]);
+	scene.Finalize(nodes, primitives, arrays);
+	return true;
+}
+
+bool LoadScene(const std::string& filename, Scene& scene, bool useCache) {
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file) {
+		std::cerr << "Could not open " << filename << std::endl;
+		return false;
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	unsigned long long hash = Hash(text.str());
+
+	std::string cacheName = filename + ".cache";
+	if (useCache) {
+		MappedFile* cache = new MappedFile();
+		if (cache->Open(cacheName) && ReadCache(*cache, hash, scene)) {
+			scene.KeepFile(cache);
+			return true;
+		}
+		// Closed before it is written again below
+		delete cache;
+	}
+
+	std::vector<std::string> meshFiles;
+	if (!ParseScene(filename, text.str(), scene, meshFiles))
+		return false;
+	scene.Finalize();
+	if (useCache && !WriteCache(cacheName, hash, meshFiles, scene))
+		std::cerr << "Could not write the scene cache " << cacheName << std::endl;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "scene.h"
+#include <string>
+
+//! Loads a scene from its text description and finalizes it
+//! With useCache the parsed scene and its BVH are also written to filename + ".cache",
+//! later loads map that file instead as long as neither the scene nor its meshes changed
+//! The BVHs then use their wide nodes and their sphere and triangle arrays straight from the mapping, which the scene keeps open
+//! Shapes, meshes and materials are copied out of it, since the scene owns and may change them
+bool LoadScene(const std::string& filename, Scene& scene, bool useCache = true);
+
+// The text format has one statement per line, # starts a comment
+//   resolution <width> <height>
+//   samples <per pixel>
+//   depth <max path depth>
+//   sampler independent|halton|sobol|bluenoise [seed]
+//   filter box|tent|gaussian|mitchell
+//   tonemap clamp|reinhard|aces [exposure]
+//   camera <position> <direction> <up>
+//   animation <frames> <frames per second>
+//   shutter <fraction of the time between frames>, for motion blur
+//   material <name> matte <color> [emit <color>]
+//   material <name> mirror [<color>] [emit <color>]
+//   material <name> glossy <color> <roughness above 0> [emit <color>]
+//   material <name> glass <index of refraction> [<color>] [emit <color>]
+//   sphere <material> <center> <radius>
+//   triangle <material> <p1> <p2> <p3>
+//   mesh <material> <file.obj|file.ply>, relative to the scene file
+//   object <name> <material> <file.obj|file.ply>, a mesh that is only rendered where it is instanced
+//   instance <object> [translate <vector>] [rotate <degrees> <axis>] [scale <vector>] ..., transforms apply in the order given
+//   light <center> <radius> <emitted color>, a black sphere that emits
+//   key <seconds> ..., animates the sphere, light, instance or camera of the statement right above it,
+//     which is the key at time 0; what follows the time is the center of a sphere or light,
+//     the transforms of an instance in the same order or the position, direction and up of the camera
+// Points, vectors and colors are three numbers
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "scheduler.h"
+#include "tracer.h"
+
+Scheduler::Scheduler(unsigned nThreads) : work(NULL), generation(0), busyThreads(0), quit(false) {
+	if (nThreads == 0) nThreads = 1;
+	for (unsigned i = 0; i < nThreads; i++)
+		queues.push_back(new WorkQueue());
+	for (unsigned i = 0; i < nThreads; i++)
+		threads.push_back(std::thread(&Scheduler::WorkerLoop, this, i));
+}
+
+Scheduler::~Scheduler() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	wakeUp.notify_all();
+	for (unsigned i = 0; i < threads.size(); i++)
+		threads[i].join();
+	for (unsigned i = 0; i < queues.size(); i++)
+		delete queues[i];
+}
+
+void Scheduler::Run(unsigned nTasks, const std::function<void(unsigned, unsigned)>& work) {
+	if (nTasks == 0) return;
+
+	// Give every thread a contiguous block of tasks, so neighbouring tiles stay on one thread
+	unsigned nThreads = GetThreadCount();
+	for (unsigned i = 0; i < nThreads; i++) {
+		unsigned first = (unsigned)((unsigned long long)nTasks * i / nThreads);
+		unsigned last = (unsigned)((unsigned long long)nTasks * (i+1) / nThreads);
+		std::lock_guard<std::mutex> lock(queues[i]->mutex);
+		for (unsigned task = first; task < last; task++)
+			queues[i]->tasks.push_back(task);
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	this->work = &work;
+	busyThreads = nThreads;
+	generation++;
+	wakeUp.notify_all();
+	while (busyThreads > 0)
+		finished.wait(lock);
+	this->work = NULL;
+}
+
+void Scheduler::WorkerLoop(unsigned thread) {
+	unsigned seenGeneration = 0;
+	while (true) {
+		const std::function<void(unsigned, unsigned)>* batch;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!quit && generation == seenGeneration)
+				wakeUp.wait(lock);
+			if (quit) return;
+			seenGeneration = generation;
+			batch = work;
+		}
+
+		unsigned task;
+		while (NextTask(thread, task))
+			(*batch)(task, thread);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyThreads == 0)
+			finished.notify_one();
+	}
+}
+
+//! Takes a task from the own queue, or steals one from the back of another thread's queue
+bool Scheduler::NextTask(unsigned thread, unsigned& task) {
+	{
+		WorkQueue& own = *queues[thread];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.tasks.empty()) {
+			task = own.tasks.front();
+			own.tasks.pop_front();
+			return true;
+		}
+	}
+
+	unsigned nThreads = GetThreadCount();
+	for (unsigned i = 1; i < nThreads; i++) {
+		WorkQueue& victim = *queues[(thread + i) % nThreads];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.back();
+			victim.tasks.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//! Thread pool that hands out numbered tasks from per-thread queues
+//! Idle threads steal work from the queues of busy threads
+class Scheduler {
+public:
+	explicit Scheduler(unsigned nThreads);
+	~Scheduler();
+
+	unsigned GetThreadCount() const { return (unsigned)threads.size(); }
+
+	//! Runs work(task, thread) for every task in [0, nTasks) and blocks until all are done
+	void Run(unsigned nTasks, const std::function<void(unsigned, unsigned)>& work);
+
+private:
+	//! Tasks waiting to be run by a single thread
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<unsigned> tasks;
+	};
+
+	void WorkerLoop(unsigned thread);
+	bool NextTask(unsigned thread, unsigned& task);
+
+	std::vector<std::thread> threads;
+	std::vector<WorkQueue*> queues;
+
+	std::mutex mutex;
+	std::condition_variable wakeUp, finished;
+	const std::function<void(unsigned, unsigned)>* work;
+	unsigned generation; // Incremented every time Run hands out a new batch
+	unsigned busyThreads;
+	bool quit;
+};
\ No newline at end of file
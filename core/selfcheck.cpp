@@ -0,0 +1,215 @@
+#include "selfcheck.h"
+#include "bvh.h"
+#include "sphere.h"
+#include "triangle.h"
+#include "trianglemesh.h"
+#include "rng.h"
+#include <iostream>
+#include <algorithm>
+
+//! Sphere that the BVH cannot tell apart from any other shape, so that leaves tested through virtual calls are checked too
+class OpaqueSphere : public Shape {
+public:
+	explicit OpaqueSphere(const Sphere& sphere) : sphere(sphere) {}
+
+	bool Intersect(const Ray& ray, float& t) const { return sphere.Intersect(ray, t); }
+	Normal GetNormal(const Point& p) const { return sphere.GetNormal(p); }
+	BBox GetBounds() const { return sphere.GetBounds(); }
+
+private:
+	Sphere sphere;
+};
+
+static float Uniform(RNG& rng, float min, float max) {
+	return min + (max - min) * rng.Uniform();
+}
+
+static Vector RandomVector(RNG& rng, float extent) {
+	return Vector(Uniform(rng, -extent, extent), Uniform(rng, -extent, extent), Uniform(rng, -extent, extent));
+}
+
+static Point RandomPoint(RNG& rng, float extent) {
+	return Point() + RandomVector(rng, extent);
+}
+
+//! Direction that is not normalized, about one in ten is parallel to one or two axes
+static Vector RandomDirection(RNG& rng) {
+	Vector d;
+	do {
+		d = RandomVector(rng, 1.f);
+	} while (d.LengthSquared() < 0.01f);
+	unsigned axes = rng.UniformUInt() % 64;
+	if (axes < 3) d[axes] = 0.f;
+	else if (axes < 6) d[(axes + 1) % 3] = d[(axes + 2) % 3] = 0.f;
+	return d;
+}
+
+//! Closest hit along the ray found by walking the binary nodes and testing every shape through Shape::Intersect
+static Hit FindReference(const BVH& bvh, const Ray& ray) {
+	const std::vector<Shape*>& primitives = bvh.GetPrimitives();
+	Hit hit;
+	float closest = ray.maxt;
+	bvh.Traverse(ray, closest, [&](unsigned first, unsigned count) -> bool {
+		for (unsigned i = first; i < first + count; i++) {
+			float t, b1, b2;
+			if (primitives[i]->Intersect(ray, t, b1, b2) && t < closest && t > 0.f) {
+				closest = hit.t = t;
+				hit.b1 = b1;
+				hit.b2 = b2;
+				hit.shape = primitives[i];
+				hit.primitive = i;
+			}
+		}
+		return false;
+	});
+	return hit;
+}
+
+//! Two different shapes only count as the same hit where they meet, as on the shared edge of two mesh triangles
+static bool SameHit(const BVH& bvh, const Hit& hit, const Hit& reference) {
+	if (!hit.shape || !reference.shape) return hit.shape == reference.shape;
+	if (hit.primitive >= bvh.GetPrimitives().size() || bvh.GetPrimitives()[hit.primitive] != hit.shape) return false;
+	if (fabsf(hit.t - reference.t) > 1e-4f * std::max(1.f, reference.t)) return false;
+	if (hit.shape != reference.shape) return true;
+	return fabsf(hit.b1 - reference.b1) < 1e-3f && fabsf(hit.b2 - reference.b2) < 1e-3f;
+}
+
+static void PrintHit(const Hit& hit) {
+	if (hit.shape) std::cerr << "primitive " << hit.primitive << " at t " << hit.t << " (" << hit.b1 << ", " << hit.b2 << ")";
+	else std::cerr << "nothing";
+}
+
+//! Counts a disagreement, only the first few are printed
+static void Report(unsigned& errors, const char* name, const char* query, unsigned ray, const Hit& hit, const Hit& reference) {
+	if (errors++ >= 10) return;
+	std::cerr << name << ": " << query << " disagrees with Traverse for ray " << ray << ", it found ";
+	PrintHit(hit);
+	std::cerr << " instead of ";
+	PrintHit(reference);
+	std::cerr << std::endl;
+}
+
+//! Returns the number of disagreements with FindReference, name tells the BVH apart in the messages
+static unsigned CheckBVH(const BVH& bvh, const char* name, const std::vector<Ray>& rays, const std::vector<std::vector<Ray> >& packets) {
+	unsigned errors = 0;
+	for (unsigned i = 0; i < rays.size(); i++) {
+		Hit reference = FindReference(bvh, rays[i]);
+		Hit hit;
+		bvh.Intersect(rays[i], hit);
+		if (!SameHit(bvh, hit, reference))
+			Report(errors, name, "Intersect", i, hit, reference);
+		if (bvh.Occluded(rays[i]) != (reference.shape != NULL) && errors++ < 10) {
+			std::cerr << name << ": Occluded disagrees with Traverse for ray " << i << ", which hits ";
+			PrintHit(reference);
+			std::cerr << std::endl;
+		}
+	}
+
+	unsigned ray = (unsigned)rays.size();
+	for (unsigned p = 0; p < packets.size(); p++) {
+		RayPacket packet;
+		packet.size = (unsigned)packets[p].size();
+		for (unsigned i = 0; i < packet.size; i++)
+			packet.SetRay(i, packets[p][i]);
+		bvh.IntersectPacket(packet);
+		for (unsigned i = 0; i < packet.size; i++, ray++) {
+			Hit reference = FindReference(bvh, packets[p][i]);
+			Hit hit = packet.GetHit(i);
+			if (!SameHit(bvh, hit, reference))
+				Report(errors, name, "IntersectPacket", ray, hit, reference);
+		}
+	}
+	return errors;
+}
+
+bool CheckTraversal() {
+	RNG rng(1);
+
+	// Shapes of every kind scattered through a cube, with a bumpy mesh floor whose triangles share their edges
+	std::vector<Sphere> spheres(250);
+	for (unsigned i = 0; i < spheres.size(); i++) {
+		spheres[i].center = RandomPoint(rng, 10.f);
+		spheres[i].radius = Uniform(rng, 0.1f, 1.f);
+	}
+	std::vector<OpaqueSphere> opaqueSpheres(spheres.begin() + 200, spheres.end());
+	spheres.resize(200);
+	std::vector<Triangle> triangles(200);
+	for (unsigned i = 0; i < triangles.size(); i++) {
+		Point center = RandomPoint(rng, 10.f);
+		triangles[i].p1 = center + RandomVector(rng, 1.5f);
+		triangles[i].p2 = center + RandomVector(rng, 1.5f);
+		triangles[i].p3 = center + RandomVector(rng, 1.5f);
+	}
+	std::vector<Shape*> shapes;
+	for (unsigned i = 0; i < spheres.size(); i++)
+		shapes.push_back(&spheres[i]);
+	for (unsigned i = 0; i < opaqueSpheres.size(); i++)
+		shapes.push_back(&opaqueSpheres[i]);
+	for (unsigned i = 0; i < triangles.size(); i++)
+		shapes.push_back(&triangles[i]);
+
+	const unsigned gridSize = 24;
+	TriangleMesh mesh;
+	for (unsigned z = 0; z < gridSize; z++) {
+		for (unsigned x = 0; x < gridSize; x++) {
+			float u = 20.f * x / (gridSize - 1) - 10.f, v = 20.f * z / (gridSize - 1) - 10.f;
+			mesh.positions.push_back(Point(u, -8.f + sinf(u) * cosf(v), v));
+		}
+	}
+	for (unsigned z = 0; z + 1 < gridSize; z++) {
+		for (unsigned x = 0; x + 1 < gridSize; x++) {
+			unsigned v = z * gridSize + x;
+			unsigned quad[6] = { v, v + 1, v + gridSize, v + 1, v + gridSize + 1, v + gridSize };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+	mesh.CreateTriangles();
+	for (unsigned i = 0; i < mesh.triangles.size(); i++)
+		shapes.push_back(&mesh.triangles[i]);
+
+	for (unsigned i = 0; i < shapes.size(); i++)
+		shapes[i]->Preprocess();
+	BVH bvh;
+	bvh.Build(shapes);
+
+	// Single rays start anywhere around the shapes, half of them end at a random distance
+	std::vector<Ray> rays;
+	for (unsigned i = 0; i < 20000; i++) {
+		float maxt = i % 2 ? INFINITY : Uniform(rng, 0.f, 30.f);
+		rays.push_back(Ray(RandomPoint(rng, 15.f), RandomDirection(rng), 0.f, maxt));
+	}
+
+	// Packets of every size, most of them coherent like camera rays, every 4th with unrelated rays
+	std::vector<std::vector<Ray> > packets(4000);
+	for (unsigned p = 0; p < packets.size(); p++) {
+		unsigned size = 1 + p % RayPacket::MaxSize;
+		bool coherent = p % 4 != 0;
+		Point o = RandomPoint(rng, 15.f);
+		Vector d = RandomDirection(rng);
+		for (unsigned i = 0; i < size; i++) {
+			float maxt = i % 3 ? INFINITY : Uniform(rng, 0.f, 30.f);
+			if (coherent)
+				packets[p].push_back(Ray(o, d + RandomVector(rng, 0.05f), 0.f, maxt));
+			else
+				packets[p].push_back(Ray(RandomPoint(rng, 15.f), RandomDirection(rng), 0.f, maxt));
+		}
+	}
+
+	unsigned errors = CheckBVH(bvh, "Built BVH", rays, packets);
+
+	// The same hierarchy again as the scene cache restores it, borrowing the arrays of the first
+	std::vector<LinearBVHNode> nodes = bvh.GetNodes();
+	BVHArrays arrays;
+	bvh.GetArrays(arrays);
+	BVH restored;
+	restored.Restore(nodes, bvh.GetPrimitives(), arrays);
+	errors += CheckBVH(restored, "Restored BVH", rays, packets);
+
+	if (errors > 0) {
+		std::cerr << "Traversal self-check failed with " << errors << " disagreements" << std::endl;
+		return false;
+	}
+	std::cout << "Traversal self-check passed for " << rays.size() << " rays and " << packets.size() << " packets through "
+		<< shapes.size() << " shapes" << std::endl;
+	return true;
+}
\ No newline at end of file
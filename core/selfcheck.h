@@ -0,0 +1,7 @@
+#pragma once
+
+//! Traces a fixed set of rays and packets through the BVH of a fixed scene of spheres, triangles, mesh triangles and other shapes
+//! Whatever BVH::Intersect, BVH::Occluded and BVH::IntersectPacket find has to match a walk of BVH::Traverse
+//! that tests every shape through Shape::Intersect, both for the built BVH and for one restored from its arrays
+//! Prints the disagreements to std::cerr and returns whether there were none
+bool CheckTraversal();
\ No newline at end of file
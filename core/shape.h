@@ -1,18 +1,94 @@
-#pragma once
-
-#include "geometry.h"
-#include "color.h"
-
-enum ShapeType {
-	DIFFUSE,
-	MIRROR
-};
-
-class Shape {
-public:
-	Color emittance;
-	Color color;
-	ShapeType type;
-	virtual Normal GetNormal(const Point& p) const = 0;
-	virtual bool Intersect(const Ray& ray, float& t) const = 0;
+#pragma once
+
+#include "geometry.h"
+#include "color.h"
+#include "raypacket.h"
+#include "material.h"
+#include "hit.h"
+
+//! Concrete type of a shape, so that acceleration structures can keep the common ones in arrays of their own
+//! and intersect them without virtual calls
+enum ShapeType { GenericShape, SphereShape, TriangleShape, MeshTriangleShape };
+
+class Shape {
+public:
+	Shape() : material(NULL), type(GenericShape) {}
+	explicit Shape(const Material* material) : material(material), type(GenericShape) {}
+	virtual ~Shape() {}
+
+	const Material* material;
+
+	ShapeType GetType() const { return type; }
+
+	virtual Normal GetNormal(const Point& p) const = 0;
+	virtual bool Intersect(const Ray& ray, float& t) const = 0;
+	virtual BBox GetBounds() const = 0;
+	//! Bounds at time in [0, 1] across the shutter interval, shapes that move during it have to override this
+	//! GetBounds then has to cover the whole interval
+	virtual BBox GetBoundsAt(float time) const { return GetBounds(); }
+
+	//! Precomputes whatever speeds up intersection, called once the scene is complete
+	virtual void Preprocess() {}
+
+	//! Surface area, needed by shapes that are sampled as lights
+	virtual float Area() const { return 0.f; }
+	//! Picks a point uniformly distributed over the surface for u1 and u2 uniform in [0,1), n is its normal
+	virtual Point Sample(float u1, float u2, Normal* n) const {
+		assert(false); // Shapes that emit light have to override this
+		return Point();
+	}
+	//! Picks a point on the surface that is visible from ref, pdf is the density of the direction towards it per unit solid angle
+	//! pdf is 0 if the sample is useless
+	virtual Point Sample(const Point& ref, float u1, float u2, Normal* n, float* pdf) const {
+		Point p = Sample(u1, u2, n);
+		Vector wi = p - ref;
+		float distanceSquared = wi.LengthSquared();
+		float cosTheta = distanceSquared > 0.f ? fabsf(Dot(*n, wi)) / sqrtf(distanceSquared) : 0.f;
+		*pdf = cosTheta > 0.f ? distanceSquared / (cosTheta * Area()) : 0.f;
+		return p;
+	}
+	//! Density with which Sample(ref, ...) picks the point p with normal n
+	virtual float Pdf(const Point& ref, const Point& p, const Normal& n) const {
+		Vector wi = p - ref;
+		float distanceSquared = wi.LengthSquared();
+		float cosTheta = distanceSquared > 0.f ? fabsf(Dot(n, wi)) / sqrtf(distanceSquared) : 0.f;
+		return cosTheta > 0.f ? distanceSquared / (cosTheta * Area()) : 0.f;
+	}
+
+	//! Also returns the barycentric coordinates of the hit, shapes without them report zeros
+	virtual bool Intersect(const Ray& ray, float& t, float& b1, float& b2) const {
+		b1 = b2 = 0.f;
+		return Intersect(ray, t);
+	}
+	//! Fills in the normals and texture coordinates of hit, whose point and barycentric coordinates are set
+	virtual void SetSurface(Hit& hit) const {
+		hit.ng = hit.ns = GetNormal(hit.p);
+		hit.u = hit.b1;
+		hit.v = hit.b2;
+	}
+
+	//! Intersects the lanes of the packet set in mask
+	//! Returns the lanes that hit this shape closer than their current hit, with the distances in tHit
+	//! and the barycentric coordinates in b1Hit and b2Hit
+	virtual unsigned IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+		unsigned hits = 0;
+		for (unsigned i = 0; i < RayPacket::MaxSize; i++) {
+			if (!(mask & (1u << i))) continue;
+			float t, b1, b2;
+			if (Intersect(packet.GetRay(i), t, b1, b2) && t < packet.t[i] && t > 0.f) {
+				tHit[i] = t;
+				b1Hit[i] = b1;
+				b2Hit[i] = b2;
+				hits |= 1u << i;
+			}
+		}
+		return hits;
+	}
+
+protected:
+	//! For the shapes that ShapeType lists, everything else is a GenericShape
+	Shape(ShapeType type, const Material* material) : material(material), type(type) {}
+
+private:
+	ShapeType type;
 };
\ No newline at end of file
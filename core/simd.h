@@ -0,0 +1,164 @@
+#pragma once
+
+#include "tracer.h"
+
+// Widest float vector the compiler is allowed to emit
+// AVX gives 8 lanes, SSE2 4, anything else falls back to plain floats
+#if defined(__AVX__)
+#define SIMD_WIDTH 8
+#include <immintrin.h>
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SIMD_WIDTH 4
+#include <emmintrin.h>
+#else
+#define SIMD_WIDTH 1
+#endif
+
+#if SIMD_WIDTH == 8
+
+//! Lane mask produced by comparing two vfloats
+struct vmask {
+	__m256 m;
+	vmask() {}
+	vmask(__m256 m) : m(m) {}
+	int Bits() const { return _mm256_movemask_ps(m); }
+	bool Any() const { return Bits() != 0; }
+	vmask operator&(const vmask& o) const { return _mm256_and_ps(m, o.m); }
+	vmask operator|(const vmask& o) const { return _mm256_or_ps(m, o.m); }
+	vmask operator~() const { return _mm256_xor_ps(m, _mm256_cmp_ps(m, m, _CMP_EQ_UQ)); }
+	//! Mask with lane i set when bit i of bits is set
+	static vmask FromBits(int bits) {
+		__m128i b = _mm_set1_epi32(bits);
+		__m128i lanesLo = _mm_set_epi32(8, 4, 2, 1);
+		__m128i lanesHi = _mm_set_epi32(128, 64, 32, 16);
+		__m128 lo = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(b, lanesLo), lanesLo));
+		__m128 hi = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(b, lanesHi), lanesHi));
+		return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+	}
+};
+
+//! SIMD_WIDTH floats processed in lockstep
+struct vfloat {
+	__m256 v;
+	vfloat() {}
+	vfloat(__m256 v) : v(v) {}
+	explicit vfloat(float f) : v(_mm256_set1_ps(f)) {}
+	static vfloat Load(const float* p) { return _mm256_loadu_ps(p); }
+	//! Converts SIMD_WIDTH bytes to floats
+	static vfloat LoadBytes(const unsigned char* p) {
+		__m128i b = _mm_loadl_epi64((const __m128i*)p);
+		__m128i lo = _mm_cvtepu8_epi32(b), hi = _mm_cvtepu8_epi32(_mm_srli_si128(b, 4));
+		return _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1));
+	}
+	void Store(float* p) const { _mm256_storeu_ps(p, v); }
+
+	vfloat operator+(const vfloat& o) const { return _mm256_add_ps(v, o.v); }
+	vfloat operator-(const vfloat& o) const { return _mm256_sub_ps(v, o.v); }
+	vfloat operator*(const vfloat& o) const { return _mm256_mul_ps(v, o.v); }
+	vfloat operator/(const vfloat& o) const { return _mm256_div_ps(v, o.v); }
+	vfloat operator-() const { return _mm256_sub_ps(_mm256_setzero_ps(), v); }
+	vmask operator<(const vfloat& o) const { return _mm256_cmp_ps(v, o.v, _CMP_LT_OQ); }
+	vmask operator<=(const vfloat& o) const { return _mm256_cmp_ps(v, o.v, _CMP_LE_OQ); }
+	vmask operator>(const vfloat& o) const { return _mm256_cmp_ps(v, o.v, _CMP_GT_OQ); }
+	vmask operator>=(const vfloat& o) const { return _mm256_cmp_ps(v, o.v, _CMP_GE_OQ); }
+};
+
+inline vfloat Min(const vfloat& a, const vfloat& b) { return _mm256_min_ps(a.v, b.v); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return _mm256_max_ps(a.v, b.v); }
+inline vfloat Sqrt(const vfloat& a) { return _mm256_sqrt_ps(a.v); }
+inline vfloat Abs(const vfloat& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v); }
+//! Picks a where m is set and b elsewhere
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b) { return _mm256_blendv_ps(b.v, a.v, m.m); }
+
+#elif SIMD_WIDTH == 4
+
+struct vmask {
+	__m128 m;
+	vmask() {}
+	vmask(__m128 m) : m(m) {}
+	int Bits() const { return _mm_movemask_ps(m); }
+	bool Any() const { return Bits() != 0; }
+	vmask operator&(const vmask& o) const { return _mm_and_ps(m, o.m); }
+	vmask operator|(const vmask& o) const { return _mm_or_ps(m, o.m); }
+	vmask operator~() const { return _mm_xor_ps(m, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+	static vmask FromBits(int bits) {
+		__m128i lanes = _mm_set_epi32(8, 4, 2, 1);
+		return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(bits), lanes), lanes));
+	}
+};
+
+struct vfloat {
+	__m128 v;
+	vfloat() {}
+	vfloat(__m128 v) : v(v) {}
+	explicit vfloat(float f) : v(_mm_set1_ps(f)) {}
+	static vfloat Load(const float* p) { return _mm_loadu_ps(p); }
+	static vfloat LoadBytes(const unsigned char* p) { return _mm_cvtepi32_ps(_mm_set_epi32(p[3], p[2], p[1], p[0])); }
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+	vfloat operator+(const vfloat& o) const { return _mm_add_ps(v, o.v); }
+	vfloat operator-(const vfloat& o) const { return _mm_sub_ps(v, o.v); }
+	vfloat operator*(const vfloat& o) const { return _mm_mul_ps(v, o.v); }
+	vfloat operator/(const vfloat& o) const { return _mm_div_ps(v, o.v); }
+	vfloat operator-() const { return _mm_sub_ps(_mm_setzero_ps(), v); }
+	vmask operator<(const vfloat& o) const { return _mm_cmplt_ps(v, o.v); }
+	vmask operator<=(const vfloat& o) const { return _mm_cmple_ps(v, o.v); }
+	vmask operator>(const vfloat& o) const { return _mm_cmpgt_ps(v, o.v); }
+	vmask operator>=(const vfloat& o) const { return _mm_cmpge_ps(v, o.v); }
+};
+
+inline vfloat Min(const vfloat& a, const vfloat& b) { return _mm_min_ps(a.v, b.v); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return _mm_max_ps(a.v, b.v); }
+inline vfloat Sqrt(const vfloat& a) { return _mm_sqrt_ps(a.v); }
+inline vfloat Abs(const vfloat& a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b) {
+	return _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v));
+}
+
+#else
+
+struct vmask {
+	bool m;
+	vmask() {}
+	vmask(bool m) : m(m) {}
+	int Bits() const { return m ? 1 : 0; }
+	bool Any() const { return m; }
+	vmask operator&(const vmask& o) const { return m && o.m; }
+	vmask operator|(const vmask& o) const { return m || o.m; }
+	vmask operator~() const { return !m; }
+	static vmask FromBits(int bits) { return (bits & 1) != 0; }
+};
+
+struct vfloat {
+	float v;
+	vfloat() {}
+	explicit vfloat(float f) : v(f) {}
+	static vfloat Load(const float* p) { return vfloat(*p); }
+	static vfloat LoadBytes(const unsigned char* p) { return vfloat((float)*p); }
+	void Store(float* p) const { *p = v; }
+
+	vfloat operator+(const vfloat& o) const { return vfloat(v + o.v); }
+	vfloat operator-(const vfloat& o) const { return vfloat(v - o.v); }
+	vfloat operator*(const vfloat& o) const { return vfloat(v * o.v); }
+	vfloat operator/(const vfloat& o) const { return vfloat(v / o.v); }
+	vfloat operator-() const { return vfloat(-v); }
+	vmask operator<(const vfloat& o) const { return v < o.v; }
+	vmask operator<=(const vfloat& o) const { return v <= o.v; }
+	vmask operator>(const vfloat& o) const { return v > o.v; }
+	vmask operator>=(const vfloat& o) const { return v >= o.v; }
+};
+
+inline vfloat Min(const vfloat& a, const vfloat& b) { return vfloat(a.v < b.v ? a.v : b.v); }
+inline vfloat Max(const vfloat& a, const vfloat& b) { return vfloat(a.v > b.v ? a.v : b.v); }
+inline vfloat Sqrt(const vfloat& a) { return vfloat(sqrtf(a.v)); }
+inline vfloat Abs(const vfloat& a) { return vfloat(fabsf(a.v)); }
+inline vfloat Select(const vmask& m, const vfloat& a, const vfloat& b) { return m.m ? a : b; }
+
+#endif
+
+// Operations shared by every width
+
+inline vfloat operator*(float f, const vfloat& a) { return vfloat(f) * a; }
+inline vfloat Clamp(const vfloat& a, const vfloat& lo, const vfloat& hi) { return Min(Max(a, lo), hi); }
+//! Bit mask with the lowest SIMD_WIDTH bits set
+inline int SIMDLaneBits() { return (1 << SIMD_WIDTH) - 1; }
\ No newline at end of file
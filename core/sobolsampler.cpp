@@ -0,0 +1,48 @@
+#include "sobolsampler.h"
+
+static unsigned ReverseBits(unsigned x) {
+	x = (x << 16) | (x >> 16);
+	x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+	x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+	x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+	x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+	return x;
+}
+
+//! Owen scrambling of the bits of x, where each bit is flipped depending on the bits above it
+//! The hash only lets lower bits affect higher ones, so it is applied to the reversed bits
+static unsigned NestedUniformScramble(unsigned x, unsigned seed) {
+	x = ReverseBits(x);
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+	return ReverseBits(x);
+}
+
+//! First two dimensions of the Sobol sequence as 32 bit fractions
+static unsigned Sobol0(unsigned i) {
+	return ReverseBits(i);
+}
+
+static unsigned Sobol1(unsigned i) {
+	unsigned result = 0;
+	for (unsigned v = 1u << 31; i > 0; i >>= 1, v ^= v >> 1)
+		if (i & 1) result ^= v;
+	return result;
+}
+
+float SobolSampler::Get1D() {
+	unsigned pixelSeed = PixelSeed(dimension++);
+	unsigned shuffled = NestedUniformScramble(index, pixelSeed);
+	return BitsToFloat(NestedUniformScramble(Sobol0(shuffled), HashCombine(pixelSeed, 1)));
+}
+
+void SobolSampler::Get2D(float* u1, float* u2) {
+	unsigned pixelSeed = PixelSeed(dimension);
+	dimension += 2;
+	unsigned shuffled = NestedUniformScramble(index, pixelSeed);
+	*u1 = BitsToFloat(NestedUniformScramble(Sobol0(shuffled), HashCombine(pixelSeed, 1)));
+	*u2 = BitsToFloat(NestedUniformScramble(Sobol1(shuffled), HashCombine(pixelSeed, 2)));
+}
\ No newline at end of file
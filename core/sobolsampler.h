@@ -0,0 +1,15 @@
+#pragma once
+
+#include "sampler.h"
+
+//! Owen scrambled Sobol points, padded: every pair of dimensions is a 2D Sobol pattern on its own,
+//! and the sample indices are shuffled differently for each pair so that the pairs do not correlate
+//! Scrambling uses hashing, so any sample of any pixel can be computed directly
+class SobolSampler : public Sampler {
+public:
+	explicit SobolSampler(unsigned seed = 0) : Sampler(seed) {}
+
+	float Get1D();
+	void Get2D(float* u1, float* u2);
+	Sampler* Clone() const { return new SobolSampler(seed); }
+};
\ No newline at end of file
@@ -1,29 +1,135 @@
-#include "sphere.h"
-
-bool Sphere::Intersect(const Ray& ray, float& t) const {
-	Vector v = ray.o - center;
-	float a = Dot(ray.d, ray.d);
-	float b = Dot(ray.d * 2.f, v);
-	float c = Dot(v, v) - radius*radius;
-	float d = b*b - 4*a*c;
-
-	if (d < 0.f) // No intersection
-		return false;
-
-	float D = sqrtf(d);
-	float s1 = (-b + D) / (2 * a);
-	float s2 = (-b - D) / (2 * a);
-
-	// Ignore intersections too close to the origin of the ray
-	// This is to prevent intersections by rounding errors
-	if (s1 < ray.mint && s2 < ray.mint) return false;
-	if (s1 < ray.mint) s1 = INFINITY;
-	if (s2 < ray.mint) s2 = INFINITY;
-
-	t = std::min(s1, s2);
-	return true;
-}
-
-Normal Sphere::GetNormal(const Point& p) const {
-	return Normal(Normalize(p - center));
+#include "sphere.h"
+#include "simd.h"
+#include <algorithm>
+
+bool Sphere::Intersect(const Ray& ray, float& t) const {
+	// Half-b form of the quadratic, only a single division per ray
+	Vector v = ray.o - center;
+	float a = Dot(ray.d, ray.d);
+	float b = Dot(ray.d, v);
+	float c = Dot(v, v) - radius*radius;
+	float d = b*b - a*c;
+
+	if (d < 0.f) // No intersection
+		return false;
+
+	float D = sqrtf(d);
+	float invA = 1.f / a;
+	float s1 = (-b + D) * invA;
+	float s2 = (-b - D) * invA;
+
+	// Ignore intersections too close to the origin of the ray
+	// This is to prevent intersections by rounding errors
+	if (s1 < ray.mint) return false;
+	t = s2 >= ray.mint ? s2 : s1;
+	return true;
+}
+
+unsigned Sphere::IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+	unsigned hits = IntersectSpherePacket(center, radius * radius, packet, mask, tHit);
+	for (unsigned i = 0; i < RayPacket::MaxSize; i++) {
+		if (hits & (1u << i))
+			b1Hit[i] = b2Hit[i] = 0.f;
+	}
+	return hits;
+}
+
+unsigned IntersectSpherePacket(const Point& center, float radius2, const RayPacket& packet, unsigned mask, float* tHit) {
+	const vfloat cx(center.x), cy(center.y), cz(center.z), r2(radius2);
+	const vfloat zero(0.f), one(1.f);
+	unsigned hits = 0;
+	for (unsigned i = 0; i < RayPacket::MaxSize; i += SIMD_WIDTH) {
+		int active = (mask >> i) & SIMDLaneBits();
+		if (!active) continue;
+
+		vfloat dx = vfloat::Load(&packet.dx[i]), dy = vfloat::Load(&packet.dy[i]), dz = vfloat::Load(&packet.dz[i]);
+		vfloat vx = vfloat::Load(&packet.ox[i]) - cx;
+		vfloat vy = vfloat::Load(&packet.oy[i]) - cy;
+		vfloat vz = vfloat::Load(&packet.oz[i]) - cz;
+		vfloat a = dx * dx + dy * dy + dz * dz;
+		vfloat b = dx * vx + dy * vy + dz * vz;
+		vfloat c = vx * vx + vy * vy + vz * vz - r2;
+		vfloat d = b * b - a * c;
+		vmask valid = d >= zero;
+		if (!(valid.Bits() & active)) continue;
+
+		// Take the near root unless it lies before the start of the ray
+		vfloat D = Sqrt(Max(d, zero));
+		vfloat invA = one / a;
+		vfloat s1 = (-b + D) * invA;
+		vfloat s2 = (-b - D) * invA;
+		vfloat mint = vfloat::Load(&packet.mint[i]);
+		vfloat t = Select(s2 >= mint, s2, s1);
+		vmask hit = valid & (t >= mint) & (t > zero) & (t < vfloat::Load(&packet.t[i]));
+		int bits = hit.Bits() & active;
+		if (bits) {
+			t.Store(&tHit[i]);
+			hits |= (unsigned)bits << i;
+		}
+	}
+	return hits;
+}
+
+Normal Sphere::GetNormal(const Point& p) const {
+	return Normal(Normalize(p - center));
+}
+
+//! Texture coordinates are the longitude and latitude of the point, both in [0, 1]
+void Sphere::SetSurface(Hit& hit) const {
+	Normal n = GetNormal(hit.p);
+	hit.ng = hit.ns = n;
+	hit.u = (atan2f(n.z, n.x) + PI) / (2.f * PI);
+	hit.v = acosf(std::min(std::max(n.y, -1.f), 1.f)) / PI;
+}
+
+BBox Sphere::GetBounds() const {
+	return BBox(center - Vector(radius, radius, radius), center + Vector(radius, radius, radius));
+}
+
+float Sphere::Area() const {
+	return 4.f * PI * radius * radius;
+}
+
+Point Sphere::Sample(float u1, float u2, Normal* n) const {
+	float z = 1.f - 2.f * u1;
+	float r = sqrtf(std::max(0.f, 1.f - z*z));
+	float phi = 2.f * PI * u2;
+	Vector d(r * cosf(phi), r * sinf(phi), z);
+	*n = Normal(d);
+	return center + radius * d;
+}
+
+//! Samples the cone of directions in which the sphere is seen from ref, which wastes no samples on the far side
+Point Sphere::Sample(const Point& ref, float u1, float u2, Normal* n, float* pdf) const {
+	Vector wc = center - ref;
+	float dc2 = wc.LengthSquared();
+	if (dc2 <= radius * radius) // ref is inside, every point is visible
+		return Shape::Sample(ref, u1, u2, n, pdf);
+
+	float dc = sqrtf(dc2);
+	wc /= dc;
+	Vector wcX, wcY;
+	CoordinateSystem(wc, &wcX, &wcY);
+
+	float sinThetaMax2 = radius * radius / dc2;
+	float cosThetaMax = sqrtf(std::max(0.f, 1.f - sinThetaMax2));
+	float cosTheta = (1.f - u1) + u1 * cosThetaMax;
+	float sinTheta2 = std::max(0.f, 1.f - cosTheta * cosTheta);
+	float phi = 2.f * PI * u2;
+	Vector dir = sqrtf(sinTheta2) * cosf(phi) * wcX + sqrtf(sinTheta2) * sinf(phi) * wcY + cosTheta * wc;
+
+	// Distance to the near side of the sphere along dir
+	float ds = dc * cosTheta - sqrtf(std::max(0.f, radius * radius - dc2 * sinTheta2));
+	Point p = ref + ds * dir;
+	*n = Normalize(Normal(p - center));
+	*pdf = 1.f / (2.f * PI * (1.f - cosThetaMax));
+	return p;
+}
+
+float Sphere::Pdf(const Point& ref, const Point& p, const Normal& n) const {
+	float dc2 = DistanceSquared(ref, center);
+	if (dc2 <= radius * radius)
+		return Shape::Pdf(ref, p, n);
+	float cosThetaMax = sqrtf(std::max(0.f, 1.f - radius * radius / dc2));
+	return 1.f / (2.f * PI * (1.f - cosThetaMax));
 }
\ No newline at end of file
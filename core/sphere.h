@@ -1,16 +1,27 @@
-#pragma once
-
-#include "geometry.h"
-#include "color.h"
-#include "shape.h"
-
-class Sphere : public Shape {
-public:
-	Sphere() { this->color = Color(); }
-	Sphere(Color color) { this->color = color; }
-	Point center;
-	float radius;
-	
-	bool Intersect(const Ray& ray, float& t) const;
-	Normal GetNormal(const Point& p) const;
+#pragma once
+
+#include "geometry.h"
+#include "color.h"
+#include "shape.h"
+
+//! Packet test against the sphere around center with squared radius radius2, see Shape::IntersectPacket
+//! Spheres have no barycentric coordinates, only tHit is written
+unsigned IntersectSpherePacket(const Point& center, float radius2, const RayPacket& packet, unsigned mask, float* tHit);
+
+class Sphere : public Shape {
+public:
+	Sphere() : Shape(SphereShape, NULL), radius(0.f) {}
+	explicit Sphere(const Material* material) : Shape(SphereShape, material), radius(0.f) {}
+	Point center;
+	float radius;
+	
+	bool Intersect(const Ray& ray, float& t) const;
+	Normal GetNormal(const Point& p) const;
+	void SetSurface(Hit& hit) const;
+	BBox GetBounds() const;
+	float Area() const;
+	Point Sample(float u1, float u2, Normal* n) const;
+	Point Sample(const Point& ref, float u1, float u2, Normal* n, float* pdf) const;
+	float Pdf(const Point& ref, const Point& p, const Normal& n) const;
+	unsigned IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const;
 };
\ No newline at end of file
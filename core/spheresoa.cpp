@@ -0,0 +1,88 @@
+#include "spheresoa.h"
+#include "sphere.h"
+#include "simd.h"
+
+void SphereSoA::Clear() {
+	cx.Clear();
+	cy.Clear();
+	cz.Clear();
+	r2.Clear();
+}
+
+void SphereSoA::Resize(unsigned n) {
+	cx.Resize(n > 0 ? n + SIMD_WIDTH : 0);
+	cy.Resize(n > 0 ? n + SIMD_WIDTH : 0);
+	cz.Resize(n > 0 ? n + SIMD_WIDTH : 0);
+	r2.Resize(n > 0 ? n + SIMD_WIDTH : 0);
+}
+
+const float* SphereSoA::GetArray(unsigned i) const {
+	const AlignedArray<float>* arrays[Arrays] = { &cx, &cy, &cz, &r2 };
+	assert(i < Arrays);
+	return arrays[i]->GetData();
+}
+
+void SphereSoA::Borrow(const float* const* arrays, unsigned size) {
+	cx.Borrow(arrays[0], size);
+	cy.Borrow(arrays[1], size);
+	cz.Borrow(arrays[2], size);
+	r2.Borrow(arrays[3], size);
+}
+
+void SphereSoA::Set(unsigned i, const Point& center, float radius) {
+	assert(i + SIMD_WIDTH < r2.GetSize());
+	cx[i] = center.x;
+	cy[i] = center.y;
+	cz[i] = center.z;
+	r2[i] = radius * radius;
+}
+
+bool SphereSoA::Intersect(const Ray& ray, unsigned first, unsigned count, float tMax, float& t, unsigned& index) const {
+	assert(first + count + SIMD_WIDTH <= r2.GetSize());
+	// Everything that only depends on the ray is computed once for all spheres
+	const vfloat ox(ray.o.x), oy(ray.o.y), oz(ray.o.z);
+	const vfloat dx(ray.d.x), dy(ray.d.y), dz(ray.d.z);
+	float a = Dot(ray.d, ray.d);
+	const vfloat va(a), invA(1.f / a);
+	const vfloat mint(ray.mint), zero(0.f);
+
+	bool hitOne = false;
+	float closest = tMax;
+	for (unsigned i = 0; i < count; i += SIMD_WIDTH) {
+		int lanes = count - i >= SIMD_WIDTH ? SIMDLaneBits() : (1 << (count - i)) - 1;
+		unsigned j = first + i;
+		vfloat vx = ox - vfloat::Load(&cx[j]);
+		vfloat vy = oy - vfloat::Load(&cy[j]);
+		vfloat vz = oz - vfloat::Load(&cz[j]);
+
+		// Half-b form of the quadratic: t = (-b -+ sqrt(b*b - a*c)) / a
+		vfloat b = dx * vx + dy * vy + dz * vz;
+		vfloat c = vx * vx + vy * vy + vz * vz - vfloat::Load(&r2[j]);
+		vfloat disc = b * b - va * c;
+		vmask valid = disc >= zero;
+		if (!(valid.Bits() & lanes)) continue;
+
+		vfloat root = Sqrt(Max(disc, zero));
+		vfloat tNear = (-b - root) * invA;
+		vfloat tFar = (-b + root) * invA;
+		vfloat tHit = Select(tNear >= mint, tNear, tFar);
+		int bits = (valid & (tHit >= mint) & (tHit > zero) & (tHit < vfloat(closest))).Bits() & lanes;
+		if (!bits) continue;
+
+		float ts[SIMD_WIDTH];
+		tHit.Store(ts);
+		for (unsigned k = 0; bits; k++, bits >>= 1) {
+			if ((bits & 1) && ts[k] < closest) {
+				closest = ts[k];
+				index = j + k;
+				hitOne = true;
+			}
+		}
+	}
+	if (hitOne) t = closest;
+	return hitOne;
+}
+
+unsigned SphereSoA::IntersectPacket(unsigned i, const RayPacket& packet, unsigned mask, float* tHit) const {
+	return IntersectSpherePacket(Point(cx[i], cy[i], cz[i]), r2[i], packet, mask, tHit);
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "geometry.h"
+#include "raypacket.h"
+#include "alignedarray.h"
+
+//! Sphere centers and squared radii stored as structure of arrays
+//! A ray is intersected with SIMD_WIDTH spheres at a time
+class SphereSoA {
+public:
+	void Clear();
+	//! Stays empty for n = 0
+	void Resize(unsigned n);
+	void Set(unsigned i, const Point& center, float radius);
+	bool IsEmpty() const { return r2.IsEmpty(); }
+
+	enum { Arrays = 4 };
+	//! Elements of each array, the spheres plus padding
+	unsigned GetArraySize() const { return r2.GetSize(); }
+	//! Array i of the centers along x, y and z and the squared radii
+	const float* GetArray(unsigned i) const;
+	//! Refers to Arrays arrays of size elements laid out as GetArray returns them instead of filling its own, see AlignedArray::Borrow
+	void Borrow(const float* const* arrays, unsigned size);
+
+	//! Finds the closest sphere in [first, first+count) hit by the ray closer than tMax
+	bool Intersect(const Ray& ray, unsigned first, unsigned count, float tMax, float& t, unsigned& index) const;
+	//! Packet test of sphere i, see Shape::IntersectPacket
+	unsigned IntersectPacket(unsigned i, const RayPacket& packet, unsigned mask, float* tHit) const;
+
+private:
+	AlignedArray<float> cx, cy, cz, r2; // Padded so that a full vector can always be loaded
+};
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "tonemapper.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+
+Tonemapper::Tonemapper(unsigned nThreads) : scheduler(nThreads), op(Clamp) {
+	SetExposure(0.f);
+	for (unsigned i = 0; i < LutSize; i++) {
+		float l = (float)i / (float)(LutSize - 1);
+		float s = l <= 0.0031308f ? 12.92f * l : 1.055f * powf(l, 1.f / 2.4f) - 0.055f;
+		srgb[i] = (unsigned char)(s * 255.f + 0.5f);
+	}
+}
+
+void Tonemapper::SetExposure(float stops) {
+	exposure = stops;
+	scale = powf(2.f, stops);
+}
+
+void Tonemapper::Convert(const std::vector<Color>& pixels, unsigned width, unsigned height, std::vector<unsigned char>& rgba) {
+	assert(pixels.size() == width * height);
+	if (rgba.size() != 4 * width * height)
+		rgba.assign(4 * width * height, 255);
+	if (pixels.empty()) return;
+
+	// Small images are not worth waking up the threads for
+	const unsigned bandHeight = 32;
+	if (width * height <= 256 * 256) {
+		ConvertPixels(&pixels[0], width * height, &rgba[0]);
+		return;
+	}
+	unsigned nBands = (height + bandHeight - 1) / bandHeight;
+	scheduler.Run(nBands, [&](unsigned band, unsigned thread) {
+		unsigned y0 = band * bandHeight;
+		unsigned y1 = std::min(y0 + bandHeight, height);
+		ConvertPixels(&pixels[y0 * width], (y1 - y0) * width, &rgba[4 * y0 * width]);
+	});
+}
+
+//! The operators work on every channel on its own, so the interleaved colors are handled as a flat array of floats
+void Tonemapper::ConvertPixels(const Color* pixels, unsigned n, unsigned char* rgba) const {
+	static_assert(sizeof(Color) == 3 * sizeof(float), "Colors have to be packed floats");
+	const float* in = &pixels[0].r;
+	const unsigned chunk = 3 * SIMD_WIDTH; // Channels of SIMD_WIDTH pixels
+	float buffer[chunk], indices[chunk];
+
+	for (unsigned first = 0; first < n; first += SIMD_WIDTH) {
+		unsigned count = std::min((unsigned)SIMD_WIDTH, n - first);
+		const float* src = in + 3 * first;
+		// The last few pixels are copied to a padded buffer, so that full vectors can always be loaded
+		if (count < SIMD_WIDTH) {
+			std::fill(buffer, buffer + chunk, 0.f);
+			std::copy(src, src + 3 * count, buffer);
+			src = buffer;
+		}
+		for (unsigned k = 0; k < chunk; k += SIMD_WIDTH) {
+			// NaNs and negatives end up as 0, infinities are cut down so the operators stay finite
+			vfloat x = Min(Max(vfloat(scale) * vfloat::Load(src + k), vfloat(0.f)), vfloat(1e6f));
+			if (op == Reinhard) {
+				x = x / (vfloat(1.f) + x);
+			}
+			else if (op == ACES) {
+				x = (x * (vfloat(2.51f) * x + vfloat(0.03f))) / (x * (vfloat(2.43f) * x + vfloat(0.59f)) + vfloat(0.14f));
+			}
+			x = Min(x, vfloat(1.f)) * vfloat((float)(LutSize - 1)) + vfloat(0.5f);
+			x.Store(indices + k);
+		}
+		unsigned char* out = rgba + 4 * first;
+		for (unsigned i = 0; i < count; i++) {
+			out[4 * i] = srgb[(unsigned)indices[3 * i]];
+			out[4 * i + 1] = srgb[(unsigned)indices[3 * i + 1]];
+			out[4 * i + 2] = srgb[(unsigned)indices[3 * i + 2]];
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "color.h"
+#include "scheduler.h"
+#include <vector>
+
+//! Turns radiance into 8 bit sRGB pixels for display or LDR files
+//! Scales by the exposure, compresses with the tonemap operator, clamps to [0, 1] and sRGB encodes through a table
+//! The colors are processed as one stream of floats, SIMD_WIDTH channels at a time
+class Tonemapper {
+public:
+	enum Operator {
+		Clamp, // Linear, everything above 1 is clipped
+		Reinhard, // x / (1 + x)
+		ACES // Filmic curve fitted to the ACES reference tonemapper
+	};
+
+	explicit Tonemapper(unsigned nThreads);
+
+	//! Exposure in stops, every stop doubles the brightness
+	void SetExposure(float stops);
+	float GetExposure() const { return exposure; }
+	void SetOperator(Operator op) { this->op = op; }
+	Operator GetOperator() const { return op; }
+
+	//! Converts width x height colors to RGBA8 pixels in rgba, rows of large images are converted in parallel
+	//! rgba is only resized when the dimensions change, so it can be handed to the display every frame
+	void Convert(const std::vector<Color>& pixels, unsigned width, unsigned height, std::vector<unsigned char>& rgba);
+	//! Converts n colors to RGBA8 on the calling thread, the alpha bytes are left alone
+	void ConvertPixels(const Color* pixels, unsigned n, unsigned char* rgba) const;
+
+private:
+	// Not copyable, owns its threads
+	Tonemapper(const Tonemapper&);
+	Tonemapper& operator=(const Tonemapper&);
+
+	enum { LutSize = 4096 }; // Entries of the sRGB table, evenly spread over [0, 1]
+
+	Scheduler scheduler;
+	float exposure;
+	float scale; // 2^exposure
+	Operator op;
+	unsigned char srgb[LutSize];
+};
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "transform.h"
+#include <cstring>
+
+static void MatrixMultiply(const float a[4][4], const float b[4][4], float r[4][4]) {
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			r[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+}
+
+//! Gauss-Jordan elimination with partial pivoting, the matrix has to be invertible
+static void MatrixInvert(const float mat[4][4], float inv[4][4]) {
+	double a[4][8];
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++) {
+			a[i][j] = mat[i][j];
+			a[i][j + 4] = i == j ? 1.0 : 0.0;
+		}
+	for (unsigned col = 0; col < 4; col++) {
+		unsigned pivot = col;
+		for (unsigned row = col + 1; row < 4; row++)
+			if (fabs(a[row][col]) > fabs(a[pivot][col])) pivot = row;
+		assert(a[pivot][col] != 0.0);
+		for (unsigned j = 0; j < 8; j++)
+			std::swap(a[col][j], a[pivot][j]);
+		double scale = 1.0 / a[col][col];
+		for (unsigned j = 0; j < 8; j++)
+			a[col][j] *= scale;
+		for (unsigned row = 0; row < 4; row++) {
+			if (row == col) continue;
+			double f = a[row][col];
+			for (unsigned j = 0; j < 8; j++)
+				a[row][j] -= f * a[col][j];
+		}
+	}
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			inv[i][j] = (float)a[i][j + 4];
+}
+
+Transform::Transform() {
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			m[i][j] = mInv[i][j] = i == j ? 1.f : 0.f;
+}
+
+Transform::Transform(const float mat[4][4]) {
+	memcpy(m, mat, sizeof(m));
+	MatrixInvert(m, mInv);
+}
+
+Transform::Transform(const float mat[4][4], const float matInv[4][4]) {
+	memcpy(m, mat, sizeof(m));
+	memcpy(mInv, matInv, sizeof(mInv));
+}
+
+Transform Transform::operator*(const Transform& t) const {
+	float r[4][4], rInv[4][4];
+	MatrixMultiply(m, t.m, r);
+	MatrixMultiply(t.mInv, mInv, rInv);
+	return Transform(r, rInv);
+}
+
+bool Transform::IsIdentity() const {
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			if (m[i][j] != (i == j ? 1.f : 0.f)) return false;
+	return true;
+}
+
+Point Transform::operator()(const Point& p) const {
+	float x = m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3];
+	float y = m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3];
+	float z = m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3];
+	float w = m[3][0] * p.x + m[3][1] * p.y + m[3][2] * p.z + m[3][3];
+	assert(w != 0.f);
+	return w == 1.f ? Point(x, y, z) : Point(x / w, y / w, z / w);
+}
+
+Vector Transform::operator()(const Vector& v) const {
+	return Vector(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+		m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+		m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+}
+
+Normal Transform::operator()(const Normal& n) const {
+	return Normal(mInv[0][0] * n.x + mInv[1][0] * n.y + mInv[2][0] * n.z,
+		mInv[0][1] * n.x + mInv[1][1] * n.y + mInv[2][1] * n.z,
+		mInv[0][2] * n.x + mInv[1][2] * n.y + mInv[2][2] * n.z);
+}
+
+Ray Transform::operator()(const Ray& r) const {
+	Ray ray(r);
+	ray.o = (*this)(r.o);
+	ray.d = (*this)(r.d);
+	return ray;
+}
+
+//! Bounds of the eight transformed corners
+BBox Transform::operator()(const BBox& b) const {
+	BBox result;
+	for (unsigned i = 0; i < 8; i++) {
+		Point corner(b[i & 1].x, b[(i >> 1) & 1].y, b[(i >> 2) & 1].z);
+		result = result.Union(result, (*this)(corner));
+	}
+	return result;
+}
+
+Transform Lerp(float t, const Transform& a, const Transform& b) {
+	const float (*ma)[4] = a.m, (*mb)[4] = b.m;
+	float m[4][4];
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			m[i][j] = Lerp(t, ma[i][j], mb[i][j]);
+	return Transform(m);
+}
+
+Transform Translate(const Vector& delta) {
+	float m[4][4] = {
+		{ 1.f, 0.f, 0.f, delta.x },
+		{ 0.f, 1.f, 0.f, delta.y },
+		{ 0.f, 0.f, 1.f, delta.z },
+		{ 0.f, 0.f, 0.f, 1.f }
+	};
+	float mInv[4][4] = {
+		{ 1.f, 0.f, 0.f, -delta.x },
+		{ 0.f, 1.f, 0.f, -delta.y },
+		{ 0.f, 0.f, 1.f, -delta.z },
+		{ 0.f, 0.f, 0.f, 1.f }
+	};
+	return Transform(m, mInv);
+}
+
+Transform Scale(float x, float y, float z) {
+	assert(x != 0.f && y != 0.f && z != 0.f);
+	float m[4][4] = {
+		{ x, 0.f, 0.f, 0.f },
+		{ 0.f, y, 0.f, 0.f },
+		{ 0.f, 0.f, z, 0.f },
+		{ 0.f, 0.f, 0.f, 1.f }
+	};
+	float mInv[4][4] = {
+		{ 1.f / x, 0.f, 0.f, 0.f },
+		{ 0.f, 1.f / y, 0.f, 0.f },
+		{ 0.f, 0.f, 1.f / z, 0.f },
+		{ 0.f, 0.f, 0.f, 1.f }
+	};
+	return Transform(m, mInv);
+}
+
+Transform Rotate(float angle, const Vector& axis) {
+	Vector a = Normalize(axis);
+	float theta = angle * PI / 180.f;
+	float s = sinf(theta), c = cosf(theta);
+	float m[4][4] = {
+		{ a.x * a.x + (1.f - a.x * a.x) * c, a.x * a.y * (1.f - c) - a.z * s, a.x * a.z * (1.f - c) + a.y * s, 0.f },
+		{ a.x * a.y * (1.f - c) + a.z * s, a.y * a.y + (1.f - a.y * a.y) * c, a.y * a.z * (1.f - c) - a.x * s, 0.f },
+		{ a.x * a.z * (1.f - c) - a.y * s, a.y * a.z * (1.f - c) + a.x * s, a.z * a.z + (1.f - a.z * a.z) * c, 0.f },
+		{ 0.f, 0.f, 0.f, 1.f }
+	};
+	// The inverse of a rotation is its transpose
+	float mInv[4][4];
+	for (unsigned i = 0; i < 4; i++)
+		for (unsigned j = 0; j < 4; j++)
+			mInv[i][j] = m[j][i];
+	return Transform(m, mInv);
+}
\ No newline at end of file
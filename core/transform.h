@@ -0,0 +1,37 @@
+#pragma once
+
+#include "geometry.h"
+
+//! Affine transformation stored as a 4x4 matrix together with its inverse
+//! Applying it to a ray leaves the direction unnormalized, so distances along the ray stay the same in both spaces
+class Transform {
+public:
+	Transform();
+	explicit Transform(const float mat[4][4]);
+	Transform(const float mat[4][4], const float matInv[4][4]);
+
+	Transform operator*(const Transform& t) const; // Applies t first
+	Transform Inverse() const { return Transform(mInv, m); }
+	bool IsIdentity() const;
+
+	Point operator()(const Point& p) const;
+	Vector operator()(const Vector& v) const;
+	//! Normals are transformed by the inverse transpose, so they stay perpendicular to transformed surfaces
+	Normal operator()(const Normal& n) const;
+	Ray operator()(const Ray& r) const;
+	BBox operator()(const BBox& b) const;
+
+private:
+	friend Transform Lerp(float t, const Transform& a, const Transform& b);
+
+	float m[4][4], mInv[4][4];
+};
+
+//! Interpolates the matrices, which moves every point along a straight line from where a puts it to where b puts it
+//! Rotations are not kept rigid, so this is only suited to the small steps within a shutter interval
+Transform Lerp(float t, const Transform& a, const Transform& b);
+
+Transform Translate(const Vector& delta);
+Transform Scale(float x, float y, float z);
+//! Rotation by angle degrees around axis, counterclockwise when looking down the axis
+Transform Rotate(float angle, const Vector& axis);
\ No newline at end of file
@@ -1,43 +1,124 @@
-#include "triangle.h"
-
-bool Triangle::Intersect(const Ray& ray, float& t) const {
-	Vector p1p2 = p2 - p1;
-	Vector p1p3 = p3 - p1;
-	Normal n = Normalize(Normal(Cross(p1p3, p1p2)));
-	float nDotRay = Dot(n, ray.d);
-	if (Dot(n, ray.d) == 0.f)
-		return false; // Ray and triangle parallel
-
-	// Calculate hit point
-	float d = Dot(n, Vector(p1.x, p1.y, p1.z));
-	float tt = -(Dot(n, Vector(ray.o.x, ray.o.y, ray.o.z)) + d) / nDotRay;
-	Point p = ray(t);
-
-	// Test edge 1
-	Vector p1p = p - p1;
-	float v = Dot(n, Cross(p1p, p1p2));
-	if (v < 0.f) return false;
-
-	// Test edge 2
-	Vector p2p = p - p2;
-	Vector p2p3 = p3 - p2;
-	float w = Dot(n, Cross(p2p, p2p3));
-	if (w < 0.f) return false;
-
-	// Test edge 3
-	Vector p3p = p - p3;
-	Vector p3p1 = p1 - p3;
-	float u = Dot(n, Cross(p3p, p3p1));
-	if (u < 0.f) return false;
-
-	// Ignore intersections too close to the origin of the ray
-	// This is to prevent intersections by rounding errors
-	if (tt < ray.mint) return false;
-	
-	t = tt;
-	return true;
-}
-
-Normal Triangle::GetNormal(const Point& p) const {
-	return Normalize(Normal(Cross(p3 - p1, p2 - p1)));
+#include "triangle.h"
+#include "simd.h"
+
+TriangleFace::TriangleFace(const Point& p1, const Point& p2, const Point& p3) {
+	n = Normal(Cross(p2 - p1, p3 - p1));
+	area = 0.5f * n.Length();
+	if (area > 0.f)
+		n = Normalize(n);
+}
+
+Point TriangleData::Sample(float u1, float u2) const {
+	float su1 = sqrtf(u1);
+	return p1 + (1.f - su1) * e1 + (u2 * su1) * e2;
+}
+
+bool TriangleData::Intersect(const Ray& ray, float& t, float& b1, float& b2) const {
+	Vector pvec = Cross(ray.d, e2);
+	float det = Dot(e1, pvec);
+	if (det == 0.f) return false; // Ray and triangle parallel
+	float invDet = 1.f / det;
+
+	Vector tvec = ray.o - p1;
+	float u = Dot(tvec, pvec) * invDet;
+	if (u < 0.f || u > 1.f) return false;
+
+	Vector qvec = Cross(tvec, e1);
+	float v = Dot(ray.d, qvec) * invDet;
+	if (v < 0.f || u + v > 1.f) return false;
+
+	// Ignore intersections too close to the origin of the ray
+	// This is to prevent intersections by rounding errors
+	float tt = Dot(e2, qvec) * invDet;
+	if (tt < ray.mint) return false;
+
+	t = tt;
+	b1 = u;
+	b2 = v;
+	return true;
+}
+
+unsigned TriangleData::IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+	return IntersectTrianglePacket(p1, e1, e2, packet, mask, tHit, b1Hit, b2Hit);
+}
+
+unsigned IntersectTrianglePacket(const Point& p1, const Vector& e1, const Vector& e2, const RayPacket& packet, unsigned mask,
+	float* tHit, float* b1Hit, float* b2Hit) {
+	const vfloat e1x(e1.x), e1y(e1.y), e1z(e1.z);
+	const vfloat e2x(e2.x), e2y(e2.y), e2z(e2.z);
+	const vfloat px(p1.x), py(p1.y), pz(p1.z);
+	const vfloat zero(0.f), one(1.f);
+	unsigned hits = 0;
+	for (unsigned i = 0; i < RayPacket::MaxSize; i += SIMD_WIDTH) {
+		int active = (mask >> i) & SIMDLaneBits();
+		if (!active) continue;
+
+		vfloat dx = vfloat::Load(&packet.dx[i]), dy = vfloat::Load(&packet.dy[i]), dz = vfloat::Load(&packet.dz[i]);
+		// pvec = d x e2
+		vfloat pvx = dy * e2z - dz * e2y;
+		vfloat pvy = dz * e2x - dx * e2z;
+		vfloat pvz = dx * e2y - dy * e2x;
+		vfloat det = e1x * pvx + e1y * pvy + e1z * pvz;
+		vmask valid = Abs(det) > zero;
+		vfloat invDet = one / det;
+
+		vfloat tx = vfloat::Load(&packet.ox[i]) - px;
+		vfloat ty = vfloat::Load(&packet.oy[i]) - py;
+		vfloat tz = vfloat::Load(&packet.oz[i]) - pz;
+		vfloat u = (tx * pvx + ty * pvy + tz * pvz) * invDet;
+		valid = valid & (u >= zero) & (u <= one);
+		if (!(valid.Bits() & active)) continue;
+
+		// qvec = tvec x e1
+		vfloat qx = ty * e1z - tz * e1y;
+		vfloat qy = tz * e1x - tx * e1z;
+		vfloat qz = tx * e1y - ty * e1x;
+		vfloat v = (dx * qx + dy * qy + dz * qz) * invDet;
+		vfloat t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+		vmask hit = valid & (v >= zero) & (u + v <= one) & (t >= vfloat::Load(&packet.mint[i])) &
+			(t > zero) & (t < vfloat::Load(&packet.t[i]));
+		int bits = hit.Bits() & active;
+		if (bits) {
+			t.Store(&tHit[i]);
+			u.Store(&b1Hit[i]);
+			v.Store(&b2Hit[i]);
+			hits |= (unsigned)bits << i;
+		}
+	}
+	return hits;
+}
+
+bool Triangle::Intersect(const Ray& ray, float& t) const {
+	float b1, b2;
+	return GetData().Intersect(ray, t, b1, b2);
+}
+
+bool Triangle::Intersect(const Ray& ray, float& t, float& b1, float& b2) const {
+	return GetData().Intersect(ray, t, b1, b2);
+}
+
+unsigned Triangle::IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+	return GetData().IntersectPacket(packet, mask, tHit, b1Hit, b2Hit);
+}
+
+Normal Triangle::GetNormal(const Point& p) const {
+	return face.n;
+}
+
+float Triangle::Area() const {
+	return face.area;
+}
+
+Point Triangle::Sample(float u1, float u2, Normal* n) const {
+	*n = face.n;
+	return GetData().Sample(u1, u2);
+}
+
+void Triangle::Preprocess() {
+	face = TriangleFace(p1, p2, p3);
+}
+
+BBox Triangle::GetBounds() const {
+	BBox bounds(p1, p2);
+	return bounds.Union(bounds, p3);
 }
\ No newline at end of file
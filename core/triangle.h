@@ -1,13 +1,57 @@
-#pragma once
-
-#include "geometry.h"
-#include "color.h"
-#include "shape.h"
-
-class Triangle : public Shape {
-public:
-	Point p1, p2, p3;
-
-	bool Intersect(const Ray& ray, float& t) const;
-	Normal GetNormal(const Point& p) const;
+#pragma once
+
+#include "geometry.h"
+#include "color.h"
+#include "shape.h"
+
+//! First vertex and edges of a triangle, worked out from its vertices where they are needed
+//! The BVH keeps the same data for intersection in a TriangleSoA
+struct TriangleData {
+	TriangleData(const Point& p1, const Point& p2, const Point& p3) : p1(p1), e1(p2 - p1), e2(p3 - p1) {}
+
+	//! Moller-Trumbore test, hits on both sides of the triangle count
+	//! b1 and b2 are the barycentric coordinates of the hit with respect to the second and third vertex
+	bool Intersect(const Ray& ray, float& t, float& b1, float& b2) const;
+	//! Packet version of Intersect, see Shape::IntersectPacket
+	unsigned IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const;
+	//! Uniformly distributed point on the triangle, see Shape::Sample
+	Point Sample(float u1, float u2) const;
+
+	Point p1;
+	Vector e1, e2; // p2 - p1 and p3 - p1
+};
+
+//! Unit normal and area of a triangle, kept per triangle so that shading and light sampling do not recompute them
+struct TriangleFace {
+	TriangleFace() : area(0.f) {}
+	TriangleFace(const Point& p1, const Point& p2, const Point& p3);
+
+	Normal n; // Geometric normal, zero for degenerate triangles
+	float area;
+};
+
+//! Packet test against the triangle with first vertex p1 and edges e1 and e2, see Shape::IntersectPacket
+unsigned IntersectTrianglePacket(const Point& p1, const Vector& e1, const Vector& e2, const RayPacket& packet, unsigned mask,
+	float* tHit, float* b1Hit, float* b2Hit);
+
+class Triangle : public Shape {
+public:
+	Triangle() : Shape(TriangleShape, NULL) {}
+	explicit Triangle(const Material* material) : Shape(TriangleShape, material) {}
+	Point p1, p2, p3;
+
+	bool Intersect(const Ray& ray, float& t) const;
+	bool Intersect(const Ray& ray, float& t, float& b1, float& b2) const;
+	Normal GetNormal(const Point& p) const;
+	BBox GetBounds() const;
+	float Area() const;
+	Point Sample(float u1, float u2, Normal* n) const;
+	unsigned IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const;
+	//! Computes the normal and area, again whenever the vertices have moved
+	void Preprocess();
+
+private:
+	TriangleData GetData() const { return TriangleData(p1, p2, p3); }
+
+	TriangleFace face;
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "trianglemesh.h"
+
+MeshTriangle::MeshTriangle(const TriangleMesh* mesh, unsigned index)
+	: Shape(MeshTriangleShape, mesh->material), mesh(mesh), index(index) {
+}
+
+const unsigned* MeshTriangle::GetIndices() const {
+	return &mesh->indices[3 * index];
+}
+
+TriangleData MeshTriangle::GetData() const {
+	const unsigned* v = GetIndices();
+	return TriangleData(mesh->positions[v[0]], mesh->positions[v[1]], mesh->positions[v[2]]);
+}
+
+const TriangleFace& MeshTriangle::GetFace() const {
+	return mesh->faces[index];
+}
+
+bool MeshTriangle::Intersect(const Ray& ray, float& t) const {
+	float b1, b2;
+	return GetData().Intersect(ray, t, b1, b2);
+}
+
+bool MeshTriangle::Intersect(const Ray& ray, float& t, float& b1, float& b2) const {
+	return GetData().Intersect(ray, t, b1, b2);
+}
+
+//! Recovers the barycentric coordinates of p, for callers that do not have them
+Normal MeshTriangle::GetNormal(const Point& p) const {
+	const Normal& ng = GetFace().n;
+	if (!mesh->HasNormals()) return ng;
+
+	TriangleData data = GetData();
+	Vector ep = p - data.p1;
+	float d11 = Dot(data.e1, data.e1), d12 = Dot(data.e1, data.e2), d22 = Dot(data.e2, data.e2);
+	float dp1 = Dot(ep, data.e1), dp2 = Dot(ep, data.e2);
+	float denom = d11 * d22 - d12 * d12;
+	if (denom == 0.f) return ng;
+	return GetShadingNormal((d22 * dp1 - d12 * dp2) / denom, (d11 * dp2 - d12 * dp1) / denom, ng);
+}
+
+//! Interpolates the vertex normals and texture coordinates where the mesh has them
+void MeshTriangle::SetSurface(Hit& hit) const {
+	hit.ng = GetFace().n;
+	hit.ns = GetShadingNormal(hit.b1, hit.b2, hit.ng);
+	if (!mesh->HasUVs()) {
+		hit.u = hit.b1;
+		hit.v = hit.b2;
+		return;
+	}
+	const unsigned* v = GetIndices();
+	const float* uvs = &mesh->uvs[0];
+	float b0 = 1.f - hit.b1 - hit.b2;
+	hit.u = b0 * uvs[2 * v[0]] + hit.b1 * uvs[2 * v[1]] + hit.b2 * uvs[2 * v[2]];
+	hit.v = b0 * uvs[2 * v[0] + 1] + hit.b1 * uvs[2 * v[1] + 1] + hit.b2 * uvs[2 * v[2] + 1];
+}
+
+Normal MeshTriangle::GetShadingNormal(float b1, float b2, const Normal& ng) const {
+	if (!mesh->HasNormals()) return ng;
+
+	const unsigned* v = GetIndices();
+	float b0 = 1.f - b1 - b2;
+	Normal ns = b0 * mesh->normals[v[0]] + b1 * mesh->normals[v[1]] + b2 * mesh->normals[v[2]];
+	if (ns.LengthSquared() == 0.f) return ng;
+	return Normalize(ns);
+}
+
+float MeshTriangle::Area() const {
+	return GetFace().area;
+}
+
+Point MeshTriangle::Sample(float u1, float u2, Normal* n) const {
+	*n = GetFace().n;
+	return GetData().Sample(u1, u2);
+}
+
+BBox MeshTriangle::GetBounds() const {
+	const unsigned* v = GetIndices();
+	BBox bounds(mesh->positions[v[0]], mesh->positions[v[1]]);
+	return bounds.Union(bounds, mesh->positions[v[2]]);
+}
+
+unsigned MeshTriangle::IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+	return GetData().IntersectPacket(packet, mask, tHit, b1Hit, b2Hit);
+}
+
+void MeshTriangle::GetVertices(Point& p1, Point& p2, Point& p3) const {
+	const unsigned* v = GetIndices();
+	p1 = mesh->positions[v[0]];
+	p2 = mesh->positions[v[1]];
+	p3 = mesh->positions[v[2]];
+}
+
+void TriangleMesh::CreateTriangles() {
+	assert(triangles.empty());
+	unsigned n = GetTriangleCount();
+	triangles.reserve(n);
+	faces.resize(n);
+	for (unsigned i = 0; i < n; i++) {
+		triangles.push_back(MeshTriangle(this, i));
+		const unsigned* v = &indices[3 * i];
+		faces[i] = TriangleFace(positions[v[0]], positions[v[1]], positions[v[2]]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "geometry.h"
+#include "shape.h"
+#include "triangle.h"
+#include <vector>
+
+class TriangleMesh;
+
+//! A single triangle of a mesh, refers to the vertex data shared by the whole mesh
+class MeshTriangle : public Shape {
+public:
+	MeshTriangle(const TriangleMesh* mesh, unsigned index);
+
+	bool Intersect(const Ray& ray, float& t) const;
+	bool Intersect(const Ray& ray, float& t, float& b1, float& b2) const;
+	Normal GetNormal(const Point& p) const;
+	void SetSurface(Hit& hit) const;
+	BBox GetBounds() const;
+	float Area() const;
+	Point Sample(float u1, float u2, Normal* n) const;
+	unsigned IntersectPacket(const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const;
+	//! Positions of the corners in the order the mesh lists them
+	void GetVertices(Point& p1, Point& p2, Point& p3) const;
+
+private:
+	const unsigned* GetIndices() const;
+	TriangleData GetData() const;
+	const TriangleFace& GetFace() const;
+	//! ng is the geometric normal, returned where the mesh has no usable vertex normals
+	Normal GetShadingNormal(float b1, float b2, const Normal& ng) const;
+
+	const TriangleMesh* mesh;
+	unsigned index; // Triangle number within the mesh
+};
+
+//! Triangles sharing vertex and index buffers and a single material
+//! Shading normals and texture coordinates are optional and stored per vertex
+class TriangleMesh {
+public:
+	explicit TriangleMesh(const Material* material = NULL) : material(material) {}
+
+	unsigned GetTriangleCount() const { return (unsigned)(indices.size() / 3); }
+	unsigned GetVertexCount() const { return (unsigned)positions.size(); }
+	bool HasNormals() const { return !normals.empty(); }
+	bool HasUVs() const { return !uvs.empty(); }
+
+	//! Creates one shape and one face per triangle, call once after the buffers are filled in
+	void CreateTriangles();
+
+	std::vector<Point> positions;
+	std::vector<Normal> normals; // Empty, or one per vertex
+	std::vector<float> uvs; // Empty, or two per vertex
+	std::vector<unsigned> indices; // Three vertices per triangle
+	std::vector<MeshTriangle> triangles;
+	std::vector<TriangleFace> faces; // Parallel to triangles
+	const Material* material;
+};
\ No newline at end of file
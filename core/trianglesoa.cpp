@@ -0,0 +1,104 @@
+#include "trianglesoa.h"
+#include "triangle.h"
+#include "simd.h"
+
+void TriangleSoA::Clear() {
+	AlignedArray<float>* arrays[Arrays] = { &p1x, &p1y, &p1z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z };
+	for (unsigned i = 0; i < Arrays; i++)
+		arrays[i]->Clear();
+}
+
+void TriangleSoA::Resize(unsigned n) {
+	AlignedArray<float>* arrays[Arrays] = { &p1x, &p1y, &p1z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z };
+	for (unsigned i = 0; i < Arrays; i++)
+		arrays[i]->Resize(n > 0 ? n + SIMD_WIDTH : 0);
+}
+
+const float* TriangleSoA::GetArray(unsigned i) const {
+	const AlignedArray<float>* arrays[Arrays] = { &p1x, &p1y, &p1z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z };
+	assert(i < Arrays);
+	return arrays[i]->GetData();
+}
+
+void TriangleSoA::Borrow(const float* const* borrowed, unsigned size) {
+	AlignedArray<float>* arrays[Arrays] = { &p1x, &p1y, &p1z, &e1x, &e1y, &e1z, &e2x, &e2y, &e2z };
+	for (unsigned i = 0; i < Arrays; i++)
+		arrays[i]->Borrow(borrowed[i], size);
+}
+
+//! The edges are computed the same way as by the TriangleData constructor, so the scalar and SoA tests find the same hits
+void TriangleSoA::Set(unsigned i, const Point& p1, const Point& p2, const Point& p3) {
+	assert(i + SIMD_WIDTH < p1x.GetSize());
+	Vector e1 = p2 - p1, e2 = p3 - p1;
+	p1x[i] = p1.x;
+	p1y[i] = p1.y;
+	p1z[i] = p1.z;
+	e1x[i] = e1.x;
+	e1y[i] = e1.y;
+	e1z[i] = e1.z;
+	e2x[i] = e2.x;
+	e2y[i] = e2.y;
+	e2z[i] = e2.z;
+}
+
+bool TriangleSoA::Intersect(const Ray& ray, unsigned first, unsigned count, float tMax, float& t, float& b1, float& b2, unsigned& index) const {
+	assert(first + count + SIMD_WIDTH <= p1x.GetSize());
+	const vfloat ox(ray.o.x), oy(ray.o.y), oz(ray.o.z);
+	const vfloat dx(ray.d.x), dy(ray.d.y), dz(ray.d.z);
+	const vfloat mint(ray.mint), zero(0.f), one(1.f);
+
+	bool hitOne = false;
+	float closest = tMax;
+	for (unsigned i = 0; i < count; i += SIMD_WIDTH) {
+		int lanes = count - i >= SIMD_WIDTH ? SIMDLaneBits() : (1 << (count - i)) - 1;
+		unsigned j = first + i;
+		vfloat ax = vfloat::Load(&e1x[j]), ay = vfloat::Load(&e1y[j]), az = vfloat::Load(&e1z[j]);
+		vfloat bx = vfloat::Load(&e2x[j]), by = vfloat::Load(&e2y[j]), bz = vfloat::Load(&e2z[j]);
+
+		// Moller-Trumbore with the operations in the order of TriangleData::Intersect
+		// pvec = d x e2
+		vfloat pvx = dy * bz - dz * by;
+		vfloat pvy = dz * bx - dx * bz;
+		vfloat pvz = dx * by - dy * bx;
+		vfloat det = ax * pvx + ay * pvy + az * pvz;
+		vmask valid = (det < zero) | (det > zero);
+		vfloat invDet = one / det;
+
+		vfloat tx = ox - vfloat::Load(&p1x[j]);
+		vfloat ty = oy - vfloat::Load(&p1y[j]);
+		vfloat tz = oz - vfloat::Load(&p1z[j]);
+		vfloat u = (tx * pvx + ty * pvy + tz * pvz) * invDet;
+		valid = valid & (u >= zero) & (u <= one);
+		if (!(valid.Bits() & lanes)) continue;
+
+		// qvec = tvec x e1
+		vfloat qx = ty * az - tz * ay;
+		vfloat qy = tz * ax - tx * az;
+		vfloat qz = tx * ay - ty * ax;
+		vfloat v = (dx * qx + dy * qy + dz * qz) * invDet;
+		vfloat tHit = (bx * qx + by * qy + bz * qz) * invDet;
+		int bits = (valid & (v >= zero) & (u + v <= one) & (tHit >= mint) & (tHit > zero) & (tHit < vfloat(closest))).Bits() & lanes;
+		if (!bits) continue;
+
+		float ts[SIMD_WIDTH], us[SIMD_WIDTH], vs[SIMD_WIDTH];
+		tHit.Store(ts);
+		u.Store(us);
+		v.Store(vs);
+		for (unsigned k = 0; bits; k++, bits >>= 1) {
+			if ((bits & 1) && ts[k] < closest) {
+				closest = ts[k];
+				b1 = us[k];
+				b2 = vs[k];
+				index = j + k;
+				hitOne = true;
+			}
+		}
+	}
+	if (hitOne) t = closest;
+	return hitOne;
+}
+
+unsigned TriangleSoA::IntersectPacket(unsigned i, const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const {
+	return IntersectTrianglePacket(Point(p1x[i], p1y[i], p1z[i]), Vector(e1x[i], e1y[i], e1z[i]), Vector(e2x[i], e2y[i], e2z[i]),
+		packet, mask, tHit, b1Hit, b2Hit);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "geometry.h"
+#include "raypacket.h"
+#include "alignedarray.h"
+
+//! First vertices and edges of triangles stored as structure of arrays
+//! A ray is intersected with SIMD_WIDTH triangles at a time
+class TriangleSoA {
+public:
+	void Clear();
+	//! Stays empty for n = 0
+	void Resize(unsigned n);
+	void Set(unsigned i, const Point& p1, const Point& p2, const Point& p3);
+	bool IsEmpty() const { return p1x.IsEmpty(); }
+
+	enum { Arrays = 9 };
+	//! Elements of each array, the triangles plus padding
+	unsigned GetArraySize() const { return p1x.GetSize(); }
+	//! Array i of the first vertices, first edges and second edges, each along x, y and z
+	const float* GetArray(unsigned i) const;
+	//! Refers to Arrays arrays of size elements laid out as GetArray returns them instead of filling its own, see AlignedArray::Borrow
+	void Borrow(const float* const* arrays, unsigned size);
+
+	//! Finds the closest triangle in [first, first+count) hit by the ray closer than tMax, see TriangleData::Intersect
+	bool Intersect(const Ray& ray, unsigned first, unsigned count, float tMax, float& t, float& b1, float& b2, unsigned& index) const;
+	//! Packet test of triangle i, see Shape::IntersectPacket
+	unsigned IntersectPacket(unsigned i, const RayPacket& packet, unsigned mask, float* tHit, float* b1Hit, float* b2Hit) const;
+
+private:
+	// Padded so that a full vector can always be loaded, padding triangles have no area and are never hit
+	AlignedArray<float> p1x, p1y, p1z, e1x, e1y, e1z, e2x, e2y, e2z;
+};
\ No newline at end of file
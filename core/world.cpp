@@ -1,17 +1,154 @@
-#include "world.h"
-
-bool World::Intersect(const Ray& ray, float& t, Shape** shape) {
-	bool hitOne = false;
-	float mint = INFINITY;
-	Shape* closest = NULL;
-	for (auto i = shapes.begin(); i != shapes.end(); i++) {
-		if ((*i)->Intersect(ray, t) && t < mint && t > 0.f) {
-			closest = *i;
-			mint = t;
-			hitOne = true;
-		}
-	}
-	*shape = closest;
-	t = mint;
-	return hitOne;
+#include "world.h"
+#include <algorithm>
+
+//! Only the closest hit gets its surface worked out, the candidates on the way are only intersected
+bool World::Intersect(const Ray& ray, Hit& hit) const {
+	if (!FindClosest(ray, hit)) return false;
+	hit.Complete(ray);
+	return true;
+}
+
+bool World::FindClosest(const Ray& ray, Hit& hit) const {
+	assert(bvh.IsBuilt() || shapes.empty());
+	hit = Hit();
+	bool hitOne = bvh.Intersect(ray, hit);
+	if (!instances.empty()) {
+		Ray instanceRay(ray);
+		if (hitOne) instanceRay.maxt = hit.t;
+		hitOne |= IntersectInstances(instanceRay, hit);
+	}
+	return hitOne;
+}
+
+bool World::Occluded(const Ray& ray) const {
+	assert(bvh.IsBuilt() || shapes.empty());
+	if (bvh.Occluded(ray)) return true;
+	if (instances.empty()) return false;
+	const std::vector<Shape*>& candidates = instanceBVH.GetPrimitives();
+	bool occluded = false;
+	instanceBVH.Traverse(ray, ray.maxt, [&](unsigned first, unsigned count) -> bool {
+		for (unsigned i = first; i < first + count && !occluded; i++)
+			occluded = static_cast<const Instance*>(candidates[i])->OccludedObject(ray);
+		return occluded;
+	});
+	return occluded;
+}
+
+//! Walks the top level and takes the ray into object space at every instance it reaches
+//! Only reports hits closer than ray.maxt, leaves hit untouched otherwise
+bool World::IntersectInstances(const Ray& ray, Hit& hit) const {
+	const std::vector<Shape*>& candidates = instanceBVH.GetPrimitives();
+	float closest = ray.maxt;
+	bool hitOne = false;
+	Ray objectRay(ray);
+	instanceBVH.Traverse(ray, closest, [&](unsigned first, unsigned count) -> bool {
+		for (unsigned i = first; i < first + count; i++) {
+			const Instance* candidate = static_cast<const Instance*>(candidates[i]);
+			objectRay.maxt = closest;
+			if (candidate->IntersectObject(objectRay, hit)) {
+				closest = hit.t;
+				hit.instance = candidate;
+				hitOne = true;
+			}
+		}
+		return false;
+	});
+	return hitOne;
+}
+
+//! Finds the closest shape for every ray of the packet
+//! Lanes without a hit keep a NULL shape
+void World::IntersectPacket(RayPacket& packet) const {
+	assert(bvh.IsBuilt() || shapes.empty());
+	bvh.IntersectPacket(packet);
+	if (instances.empty()) return;
+	// Rays of a packet diverge once they are in object space, so instances are intersected ray by ray
+	for (unsigned i = 0; i < packet.size; i++) {
+		Ray ray = packet.GetRay(i);
+		ray.maxt = packet.t[i];
+		Hit hit;
+		if (IntersectInstances(ray, hit))
+			packet.SetHit(i, hit);
+	}
+}
+
+//! Adds every triangle of the mesh, the mesh has to outlive the world
+void World::AddMesh(TriangleMesh* mesh) {
+	if (mesh->triangles.empty())
+		mesh->CreateTriangles();
+	shapes.reserve(shapes.size() + mesh->triangles.size());
+	for (unsigned i = 0; i < mesh->triangles.size(); i++)
+		shapes.push_back(&mesh->triangles[i]);
+}
+
+//! Prepares the world for rendering, call after all shapes have been added
+void World::Finalize(bool buildBVH) {
+	for (unsigned i = 0; i < shapes.size(); i++) {
+		assert(shapes[i]->material);
+		shapes[i]->Preprocess();
+	}
+	if (buildBVH)
+		bvh.Build(shapes);
+	UpdateInstances();
+
+	lights.clear();
+	lightCdf.clear();
+	float totalPower = 0.f;
+	for (unsigned i = 0; i < shapes.size(); i++) {
+		const Color& e = shapes[i]->material->emittance;
+		float power = (e.r + e.g + e.b) * shapes[i]->Area();
+		if (power <= 0.f) continue;
+		lights.push_back(shapes[i]);
+		totalPower += power;
+		lightCdf.push_back(totalPower);
+	}
+	lightPdfs.clear();
+	for (unsigned i = 0; i < lightCdf.size(); i++) {
+		float previous = i > 0 ? lightCdf[i-1] : 0.f;
+		lightPdfs[lights[i]] = (lightCdf[i] - previous) / totalPower;
+	}
+	for (unsigned i = 0; i < lightCdf.size(); i++)
+		lightCdf[i] /= totalPower;
+}
+
+void World::UpdateInstances() {
+	// Instances of empty meshes have nothing to hit and no bounds
+	std::vector<Shape*> top;
+	top.reserve(instances.size());
+	bool motion = false;
+	for (unsigned i = 0; i < instances.size(); i++) {
+		if (!instances[i]->GetInstancedMesh()->IsBuilt()) continue;
+		top.push_back(instances[i]);
+		motion |= instances[i]->IsMoving();
+	}
+	instanceBVH.Build(top, motion);
+}
+
+void World::Refit(bool shapesMoved) {
+	if (shapesMoved) {
+		for (unsigned i = 0; i < shapes.size(); i++)
+			shapes[i]->Preprocess();
+		bvh.Refit();
+	}
+	// The top level only keeps bounds for both ends of the shutter if some instance moved while it was built
+	bool motion = false;
+	for (unsigned i = 0; i < instances.size(); i++)
+		motion |= instances[i]->GetInstancedMesh()->IsBuilt() && instances[i]->IsMoving();
+	if (motion == instanceBVH.HasMotion())
+		instanceBVH.Refit();
+	else
+		UpdateInstances();
+}
+
+float World::LightPdf(const Shape* light) const {
+	std::unordered_map<const Shape*, float>::const_iterator it = lightPdfs.find(light);
+	return it == lightPdfs.end() ? 0.f : it->second;
+}
+
+const Shape* World::SampleLight(float u, float* pdf) const {
+	if (lights.empty()) return NULL;
+	unsigned i = (unsigned)(std::upper_bound(lightCdf.begin(), lightCdf.end(), u) - lightCdf.begin());
+	if (i >= lights.size()) i = (unsigned)lights.size() - 1;
+	*pdf = LightPdf(lights[i]);
+	return lights[i];
 }
\ No newline at end of file
@@ -1,15 +1,57 @@
-#pragma once
-
-#include "geometry.h"
-#include <vector>
-#include "shape.h"
-
-class World {
-public:
-	bool Intersect(const Ray& ray, float& t, Shape** shape);
-
-	void AddShape(Shape* shape) { shapes.push_back(shape); }
-	
-private:
-	std::vector<Shape*> shapes;
+#pragma once
+
+#include "geometry.h"
+#include <vector>
+#include <unordered_map>
+#include "shape.h"
+#include "bvh.h"
+#include "trianglemesh.h"
+#include "instance.h"
+
+class World {
+public:
+	//! Finds the closest hit and fills in all of hit, hit.shape is left NULL if the ray hits nothing
+	bool Intersect(const Ray& ray, Hit& hit) const;
+	//! Same, but only sets what traversal sets, for hits whose surface is worked out later, see Hit::Complete
+	bool FindClosest(const Ray& ray, Hit& hit) const;
+	//! Whether anything lies along the ray closer than ray.maxt, cheaper than Intersect since any hit will do
+	bool Occluded(const Ray& ray) const;
+	//! Only sets what traversal sets, see Hit::Complete
+	void IntersectPacket(RayPacket& packet) const;
+
+	void AddShape(Shape* shape) { shapes.push_back(shape); }
+	void AddMesh(TriangleMesh* mesh);
+	//! The instance has to outlive the world, and its geometry has to be built before it was placed
+	void AddInstance(Instance* instance) { instances.push_back(instance); }
+	//! Rebuilds only the top level over the instances, after some of them moved
+	void UpdateInstances();
+	//! Updates the acceleration structures after shapes or instances moved, without building them again
+	//! Meant for small steps such as the frames of an animation, without shapesMoved only the instances are refit
+	void Refit(bool shapesMoved = true);
+	//! Without buildBVH the hierarchy has to be restored through GetBVH beforehand
+	void Finalize(bool buildBVH = true);
+
+	const std::vector<Shape*>& GetShapes() const { return shapes; }
+	const std::vector<Instance*>& GetInstances() const { return instances; }
+	BVH& GetBVH() { return bvh; }
+	const BVH& GetBVH() const { return bvh; }
+
+	//! Shapes whose material emits light, collected by Finalize
+	const std::vector<const Shape*>& GetLights() const { return lights; }
+	//! Picks a light with probability proportional to its emitted power, for u uniform in [0,1)
+	//! Returns NULL if there are no lights
+	const Shape* SampleLight(float u, float* pdf) const;
+	//! Probability that SampleLight picks light, 0 for shapes that do not emit
+	float LightPdf(const Shape* light) const;
+	
+private:
+	bool IntersectInstances(const Ray& ray, Hit& hit) const;
+
+	std::vector<Shape*> shapes;
+	BVH bvh; // Acceleration structure over shapes, built by Finalize
+	std::vector<Instance*> instances;
+	BVH instanceBVH; // Top level over instances, each has a bottom level over its own geometry
+	std::vector<const Shape*> lights;
+	std::vector<float> lightCdf; // Running sum of the power of the lights, normalized to end at 1
+	std::unordered_map<const Shape*, float> lightPdfs;
 };
\ No newline at end of file
@@ -1,235 +1,414 @@
-#include <SFML/Graphics.hpp>
-#include "../core/geometry.h"
-#include "../core/camera.h"
-#include "../core/sphere.h"
-#include "../core/color.h"
-#include "../core/world.h"
-#include "../core/triangle.h"
-#include "../core/tracer.h"
-#include <random>
-#include <ctime>
-#include <sstream>
-#include <fstream>
-
-unsigned w = 1280;
-unsigned h = 720;
-
-World world;
-Camera camera(w, h);
-sf::Image image;
-sf::Sprite sprite;
-unsigned iteration = 1;
-
-std::uniform_real_distribution<> urd;
-std::mt19937 mt((unsigned)time(0));
-
-void HandleEvents(sf::RenderWindow& window);
-void Render(sf::RenderWindow& window);
-void ClearImage();
-void TraceRays(unsigned maxIterations, sf::Texture& texture);
-Color TraceRay(const Ray& ray, unsigned depth);
-Vector RandomDirection(const Normal& n);
-
-int main() {
-	sf::RenderWindow window(sf::VideoMode(w, h), "SmurfPT");
-	sf::Texture texture;
-
-	Sphere sphere1(Color(1.f, 0.f, 0.f));
-	sphere1.center = Point(5.f, 1.f, 5.f);
-	sphere1.radius = 3.f;
-	sphere1.type = DIFFUSE;
-	world.AddShape(&sphere1);
-	Sphere sphere2(Color(0.f, 0.f, 1.f));
-	sphere2.center = Point(1.f, 1.f, 4.f);
-	sphere2.radius = 1.f;
-	sphere2.type = DIFFUSE;
-	world.AddShape(&sphere2);
-	Sphere sphere3(Color(0.f, 1.f, 1.f));
-	sphere3.center = Point(5.f, 3.f, -5.f);
-	sphere3.radius = 1.f;
-	sphere3.type = DIFFUSE;
-	world.AddShape(&sphere3);
-	Sphere sphere4(Color(1.f, 1.f, 0.f));
-	sphere4.center = Point(-5.f, 1.f, -5.f);
-	sphere4.radius = 2.f;
-	sphere4.type = DIFFUSE;
-	world.AddShape(&sphere4);
-	Sphere sphere5;
-	sphere5.center = Point(-2.5f, 3.f, 4.f);
-	sphere5.radius = 2.f;
-	sphere5.type = MIRROR;
-	world.AddShape(&sphere5);
-	Sphere sphere6(Color(1.f, 1.f, 1.f));
-	sphere6.center = Point(-6.f, 2.5f, 3.5f);
-	sphere6.radius = 3.f;
-	sphere6.type = DIFFUSE;
-	world.AddShape(&sphere6);
-	Sphere sphere7;
-	sphere7.center = Point(1.f, 2.f, -6.f);
-	sphere7.radius = 2.5f;
-	sphere7.type = MIRROR;
-	world.AddShape(&sphere7);
-
-	Triangle triangle;
-	triangle.color = Color(0.f, 1.f, 0.f);
-	triangle.p1 = Point(-300.f, 0.f, 300.f);
-	triangle.p2 = Point(0.f, 0.f, -100.f);
-	triangle.p3 = Point(300.f, 0.f, 300.f);
-	triangle.type = DIFFUSE;
-	world.AddShape(&triangle);
-
-	Sphere light2(Color(0.f, 0.f, 0.f));
-	light2.center = Point(0.f, 0.f, 0.f);
-	light2.radius = 1.5f;
-	light2.emittance = Color(10.f, 10.f, 10.f);
-	light2.type = DIFFUSE;
-	//world.AddShape(&light2);
-	Sphere light(Color(0.f, 0.f, 0.f));
-	light.center = Point(1000.f, 1020.f, 0.f);
-	light.radius = 1000.f;
-	light.emittance = Color(1.f, 1.f, 1.f);
-	light.type = DIFFUSE;
-	//world.AddShape(&light);
-
-	camera.position = Point(0.f, 25.f, -25.f);
-	camera.direction = Normalize(Vector(0.f, -1.f, 1.f));
-	camera.up = Normalize(Vector(0.f, 1.f, 1.f));
-	camera.right = Normalize(Vector(1.f, 0.f, 0.f));
-
-	image.create(camera.film.GetWidth(), camera.film.GetHeight());
-	texture.create(camera.film.GetWidth(), camera.film.GetHeight());
-	sprite.setTexture(texture);
-
-	while(window.isOpen()) {
-		HandleEvents(window);
-
-		const unsigned nSamples = 3000;
-		if (iteration <= nSamples) {
-
-			std::stringstream ss;
-			ss << iteration;
-			std::string caption = "Tracer - Iteration: " + ss.str();
-
-			window.setTitle(caption);
-			TraceRays(nSamples, texture);
-			iteration++;
-			Render(window);
-		}
-	}
-
-	return 0;
-}
-
-void HandleEvents(sf::RenderWindow& window) {
-	float cameraStep = 0.2f;
-	sf::Event e;
-	while (window.pollEvent(e)) {
-		if (e.type == sf::Event::Closed)
-			window.close();
-		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::Escape)
-			window.close();
-		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::A) {
-			camera.MoveLeft(cameraStep);
-			camera.film.Clear();
-			iteration = 1;
-		}
-		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::D) {
-			camera.MoveRight(cameraStep);
-			camera.film.Clear();
-			iteration = 1;
-		}
-		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::W) {
-			camera.MoveForward(cameraStep);
-			camera.film.Clear();
-			iteration = 1;
-		}
-		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::S) {
-			camera.MoveBackward(cameraStep);
-			camera.film.Clear();
-			iteration = 1;
-		}
-		if (e.type == sf::Event::Resized) {
-			Render(window);
-		}
-	}
-}
-
-void Render(sf::RenderWindow& window) {
-	window.clear();
-	window.draw(sprite);
-	window.display();
-}
-
-void ClearImage() {
-	for (unsigned y = 0; y < camera.film.GetHeight(); y++) {
-		for (unsigned x = 0; x < camera.film.GetWidth(); x++) {
-			image.setPixel(x, y, sf::Color(0, 0, 0));
-		}
-	}
-}
-
-Vector UniformSample(const Normal& n) {
-	Vector vn(n.x, n.y, n.z);
-	Vector t, b;
-	CoordinateSystem(vn, &t, &b);
-	float u1 = (float)urd(mt);
-	float u2 = (float)urd(mt);
-
-	float r = sqrtf(1.0f - u1*u1);
-	float phi = u2 * 2.f * PI;
-
-	Vector v(cosf(phi) * r, u1, sinf(phi) * r);
-	return t * v.x + vn * v.y + b * v.z;
-}
-
-Vector Reflect(const Normal& n, const Vector& dir) {
-	return dir - 2.f * Dot(n, dir) * n;
-}
-
-Color TraceRay(const Ray& ray, unsigned depth) {
-	const unsigned maxDepth = 4;
-	if (depth > maxDepth)
-		return Color(0.f, 0.f, 0.f);
-
-	float t;
-	Shape* shape = NULL;
-	if (!world.Intersect(ray, t, &shape))
-		return Color(0.6f, 0.6f, 0.9f);
-
-	Point p = ray(t);
-	Normal n = shape->GetNormal(p);
-	
-	Vector newDir;
-	if (shape->type == DIFFUSE) {
-		newDir = UniformSample(n);
-		Ray newRay(p, newDir, 0.001f);
-		return TraceRay(newRay, depth+1) * Dot(n, newDir) * shape->color + shape->emittance;
-	}
-	else if (shape->type == MIRROR) {
-		newDir = Reflect(n, ray.d);
-		Ray newRay(p, newDir, 0.00001f);
-		return TraceRay(newRay, depth+1);
-	}
-	
-	return Color(0.f, 0.f, 0.f);
-}
-
-void TraceRays(unsigned maxIterations, sf::Texture& texture) {
-	for (unsigned y = 0; y < camera.film.GetHeight(); y++) {
-		for (unsigned x = 0; x < camera.film.GetWidth(); x++) {
-			Ray ray = camera.GetJitteredRay(x, y);
-			Color l = TraceRay(ray, 0);
-			Color c = camera.film.GetPixel(x, y);
-			camera.film.SetPixel(x, y, l + c);
-		}
-	}
-
-	for (unsigned y = 0; y < camera.film.GetHeight(); y++) {
-		for (unsigned x = 0; x < camera.film.GetWidth(); x++) {
-			Color c = camera.film.GetPixel(x,y);
-			c /= (float)iteration;
-			image.setPixel(x, y, c.ToSFMLColor());
-		}
-	}
-	texture.update(image);
+#include <SFML/Graphics.hpp>
+#include "../core/geometry.h"
+#include "../core/camera.h"
+#include "../core/color.h"
+#include "../core/world.h"
+#include "../core/scene.h"
+#include "../core/sceneio.h"
+#include "../core/tracer.h"
+#include "../core/renderer.h"
+#include "../core/meshio.h"
+#include "../core/imageio.h"
+#include "../core/renderthread.h"
+#include "../core/independentsampler.h"
+#include "../core/haltonsampler.h"
+#include "../core/sobolsampler.h"
+#include "../core/bluenoisesampler.h"
+#include "../core/denoiser.h"
+#include "../core/filter.h"
+#include "../core/tonemapper.h"
+#include "../core/selfcheck.h"
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <cstring>
+#include <cstdlib>
+#include <iomanip>
+#include <algorithm>
+
+unsigned w = 1280;
+unsigned h = 720;
+bool denoise = false; // Toggled with N in the window
+float exposure = 0.f; // Changed with + and - in the window
+Tonemapper::Operator tonemap = Tonemapper::Clamp; // Cycled with T in the window
+
+Camera camera(w, h);
+sf::Sprite sprite;
+
+void HandleEvents(sf::RenderWindow& window, RenderThread& renderThread);
+void Render(sf::RenderWindow& window);
+void UpdateTexture(const std::vector<Color>& pixels, Tonemapper& tonemapper, std::vector<unsigned char>& framebuffer, sf::Texture& texture);
+bool RenderBatch(Renderer& renderer, Denoiser& denoiser, const Tonemapper& tonemapper, unsigned nSamples, const std::string& output);
+bool RenderAnimation(Scene& scene, Renderer& renderer, Denoiser& denoiser, const Tonemapper& tonemapper, unsigned nSamples,
+	const std::string& output, float shutter);
+
+int main(int argc, char* argv[]) {
+	// Usage: SmurfPT [-threads n] [-packet 1|4|8|16] [-mesh file.obj|file.ply] [-width w] [-height h]
+	//                [-batch] [-spp n] [-o file.pfm|exr|ppm|png] [-fps n] [-depth n] [-wavefront]
+	//                [-sampler independent|halton|sobol|bluenoise] [-seed n] [-adaptive threshold] [-minspp n]
+	//                [-filter box|tent|gaussian|mitchell] [-denoise] [-exposure stops] [-tonemap clamp|reinhard|aces]
+	//                [-noreproject] [-budget ms] [-scene file] [-nocache] [-animate] [-frame n] [-shutter fraction]
+	//        SmurfPT -selfcheck
+	// The scene file, scenes/demo.scene by default, also gives the resolution, samples, depth, sampler, filter,
+	// tonemap, camera and shutter, the options override those
+	// It is cached in file.cache together with its BVH, so loading it again is fast, -nocache always parses it
+	// -mesh adds a white mesh to the scene
+	// With -adaptive a pixel stops getting samples once the relative error of its average drops below threshold,
+	// -spp is then the most samples a pixel can get
+	// -denoise filters the output image, and the window to begin with
+	// -exposure and -tonemap set how radiance is mapped to the window and to PPM and PNG files
+	// With -batch the image is rendered without opening a window and written to the -o file
+	// -animate renders every frame of an animated scene that way, to the -o file with the frame number appended
+	// -frame shows or renders the scene as it is at that frame, counting from 0
+	// -shutter is how long the shutter is open as a fraction of the time between frames, 0 turns motion blur off
+	// Otherwise the window shows the film -fps times per second while it is rendered in the background
+	// Moving the camera reuses the image of the old view where it is still visible, unless -noreproject is given
+	// While the camera moves, passes are rendered at a lower resolution so that they take at most -budget ms,
+	// one frame at -fps by default, 0 always renders at full resolution
+	// -selfcheck only compares the SIMD traversals of the BVH with a plain one on a fixed scene, see CheckTraversal
+	std::string sceneFile = "scenes/demo.scene";
+	bool useCache = true;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-scene") == 0 && i+1 < argc)
+			sceneFile = argv[++i];
+		else if (strcmp(argv[i], "-nocache") == 0)
+			useCache = false;
+		else if (strcmp(argv[i], "-selfcheck") == 0)
+			return CheckTraversal() ? 0 : 1;
+	}
+	Scene scene;
+	std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+	if (!LoadScene(sceneFile, scene, useCache))
+		return 1;
+	std::cout << "Loaded " << sceneFile << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::high_resolution_clock::now() - loadStart).count() << " ms" << std::endl;
+
+	const SceneSettings& settings = scene.settings;
+	w = settings.width;
+	h = settings.height;
+	exposure = settings.exposure;
+	unsigned nThreads = std::thread::hardware_concurrency();
+	unsigned packetSize = 16;
+	const char* meshFile = NULL;
+	bool batch = false;
+	unsigned nSamples = settings.samples;
+	std::string output = "render.exr";
+	unsigned fps = 30;
+	unsigned maxDepth = settings.maxDepth;
+	bool wavefront = false;
+	std::string samplerName = settings.sampler;
+	unsigned seed = settings.seed;
+	float adaptiveThreshold = 0.f;
+	unsigned minSamples = 16;
+	std::string filterName = settings.filter;
+	std::string tonemapName = settings.tonemap;
+	bool reproject = true;
+	int budget = -1;
+	bool animate = false;
+	unsigned frame = 0;
+	float shutter = settings.shutter;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-threads") == 0 && i+1 < argc)
+			nThreads = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-packet") == 0 && i+1 < argc) {
+			packetSize = (unsigned)atoi(argv[++i]);
+			if (packetSize != 1 && packetSize != 4 && packetSize != 8 && packetSize != 16) {
+				std::cerr << "Invalid packet size " << argv[i] << ", expected 1, 4, 8 or 16" << std::endl;
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-mesh") == 0 && i+1 < argc)
+			meshFile = argv[++i];
+		else if (strcmp(argv[i], "-width") == 0 && i+1 < argc)
+			w = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-height") == 0 && i+1 < argc)
+			h = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-batch") == 0)
+			batch = true;
+		else if (strcmp(argv[i], "-spp") == 0 && i+1 < argc)
+			nSamples = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-o") == 0 && i+1 < argc)
+			output = argv[++i];
+		else if (strcmp(argv[i], "-fps") == 0 && i+1 < argc)
+			fps = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-depth") == 0 && i+1 < argc)
+			maxDepth = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-wavefront") == 0)
+			wavefront = true;
+		else if (strcmp(argv[i], "-sampler") == 0 && i+1 < argc)
+			samplerName = argv[++i];
+		else if (strcmp(argv[i], "-seed") == 0 && i+1 < argc)
+			seed = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-adaptive") == 0 && i+1 < argc)
+			adaptiveThreshold = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-minspp") == 0 && i+1 < argc)
+			minSamples = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-filter") == 0 && i+1 < argc)
+			filterName = argv[++i];
+		else if (strcmp(argv[i], "-exposure") == 0 && i+1 < argc)
+			exposure = (float)atof(argv[++i]);
+		else if (strcmp(argv[i], "-tonemap") == 0 && i+1 < argc)
+			tonemapName = argv[++i];
+		else if (strcmp(argv[i], "-budget") == 0 && i+1 < argc)
+			budget = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-noreproject") == 0)
+			reproject = false;
+		else if (strcmp(argv[i], "-denoise") == 0)
+			denoise = true;
+		else if (strcmp(argv[i], "-animate") == 0)
+			animate = true;
+		else if (strcmp(argv[i], "-frame") == 0 && i+1 < argc)
+			frame = (unsigned)atoi(argv[++i]);
+		else if (strcmp(argv[i], "-shutter") == 0 && i+1 < argc)
+			shutter = std::min(std::max((float)atof(argv[++i]), 0.f), 1.f);
+		else if (strcmp(argv[i], "-scene") == 0 && i+1 < argc)
+			i++; // Already loaded
+	}
+	if (nThreads == 0) nThreads = 1;
+	if (nSamples == 0) nSamples = 1;
+	if (w == 0 || h == 0) {
+		std::cerr << "Invalid resolution" << std::endl;
+		return 1;
+	}
+	if (w != camera.film.GetWidth() || h != camera.film.GetHeight())
+		camera.SetResolution(w, h);
+
+	if (meshFile) {
+		TriangleMesh* mesh = scene.AddMesh(scene.AddMaterial(MaterialDesc()));
+		// LoadMesh has reported why, rendering without the mesh would only hide that
+		if (!LoadMesh(meshFile, *mesh))
+			return 1;
+		scene.Finalize();
+	}
+	Renderer renderer(scene.world, camera, nThreads);
+	renderer.SetPacketSize(packetSize);
+	renderer.SetMaxDepth(maxDepth);
+	renderer.SetWavefront(wavefront);
+	if (samplerName == "independent")
+		renderer.SetSampler(IndependentSampler(seed));
+	else if (samplerName == "halton")
+		renderer.SetSampler(HaltonSampler(seed));
+	else if (samplerName == "bluenoise")
+		renderer.SetSampler(BlueNoiseSampler(seed));
+	else if (samplerName == "sobol")
+		renderer.SetSampler(SobolSampler(seed));
+	else {
+		std::cerr << "Unknown sampler " << samplerName << std::endl;
+		return 1;
+	}
+	renderer.SetAdaptive(adaptiveThreshold, minSamples);
+	if (filterName == "tent")
+		camera.film.SetFilter(TentFilter());
+	else if (filterName == "gaussian")
+		camera.film.SetFilter(GaussianFilter());
+	else if (filterName == "mitchell")
+		camera.film.SetFilter(MitchellFilter());
+	else if (filterName == "box")
+		camera.film.SetFilter(BoxFilter());
+	else {
+		std::cerr << "Unknown filter " << filterName << std::endl;
+		return 1;
+	}
+
+	// Motion blur only makes a difference when something moves
+	renderer.SetMotionBlur(shutter > 0.f && scene.IsAnimated());
+	if (scene.IsAnimated()) {
+		float time = (float)frame / settings.frameRate;
+		scene.SetTime(time, shutter / settings.frameRate);
+		scene.SetupCamera(camera, time, shutter / settings.frameRate);
+	}
+	else {
+		scene.SetupCamera(camera);
+	}
+
+	if (tonemapName == "reinhard")
+		tonemap = Tonemapper::Reinhard;
+	else if (tonemapName == "aces")
+		tonemap = Tonemapper::ACES;
+	else if (tonemapName == "clamp")
+		tonemap = Tonemapper::Clamp;
+	else {
+		std::cerr << "Unknown tonemap operator " << tonemapName << std::endl;
+		return 1;
+	}
+	Tonemapper tonemapper(nThreads);
+	tonemapper.SetExposure(exposure);
+	tonemapper.SetOperator(tonemap);
+
+	Denoiser denoiser(nThreads);
+	if (animate)
+		return RenderAnimation(scene, renderer, denoiser, tonemapper, nSamples, output, shutter) ? 0 : 1;
+	if (batch)
+		return RenderBatch(renderer, denoiser, tonemapper, nSamples, output) ? 0 : 1;
+
+	sf::RenderWindow window(sf::VideoMode(w, h), "SmurfPT");
+	sf::Texture texture;
+	texture.create(camera.film.GetWidth(), camera.film.GetHeight());
+	sprite.setTexture(texture);
+	window.setFramerateLimit(fps);
+
+	// The render thread owns the camera and film from here on
+	const unsigned maxIterations = 3000;
+	RenderThread renderThread(renderer, camera, maxIterations);
+	renderThread.SetReprojection(reproject);
+	renderThread.SetFrameBudget(budget >= 0 ? (float)budget / 1000.f : 1.f / (float)std::max(fps, 1u));
+	renderThread.Start();
+
+	FilmImage snapshot;
+	std::vector<Color> denoised;
+	std::vector<unsigned char> framebuffer; // RGBA pixels handed to the texture, reused every frame
+	unsigned iteration = 0;
+	bool denoiseShown = denoise;
+	while(window.isOpen()) {
+		HandleEvents(window, renderThread);
+
+		bool newSnapshot = renderThread.GetSnapshot(snapshot, iteration);
+		bool newImage = newSnapshot || denoise != denoiseShown;
+		bool newTonemap = exposure != tonemapper.GetExposure() || tonemap != tonemapper.GetOperator();
+		if ((newImage || newTonemap) && !snapshot.color.empty()) {
+			if (newImage) {
+				std::stringstream ss;
+				ss << iteration;
+				std::string caption = "Tracer - Iteration: " + ss.str();
+				if (denoise) caption += " (denoised)";
+
+				window.setTitle(caption);
+				if (denoise)
+					denoiser.Denoise(snapshot, denoised);
+				denoiseShown = denoise;
+			}
+			tonemapper.SetExposure(exposure);
+			tonemapper.SetOperator(tonemap);
+			UpdateTexture(denoise ? denoised : snapshot.color, tonemapper, framebuffer, texture);
+		}
+		Render(window);
+	}
+	renderThread.Stop();
+
+	return 0;
+}
+
+void HandleEvents(sf::RenderWindow& window, RenderThread& renderThread) {
+	float cameraStep = 0.2f;
+	sf::Event e;
+	while (window.pollEvent(e)) {
+		if (e.type == sf::Event::Closed)
+			window.close();
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::Escape)
+			window.close();
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::A) {
+			renderThread.UpdateCamera([cameraStep](Camera& c) { c.MoveLeft(cameraStep); });
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::D) {
+			renderThread.UpdateCamera([cameraStep](Camera& c) { c.MoveRight(cameraStep); });
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::W) {
+			renderThread.UpdateCamera([cameraStep](Camera& c) { c.MoveForward(cameraStep); });
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::N) {
+			denoise = !denoise;
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::Add) {
+			exposure += 0.5f;
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::Subtract) {
+			exposure -= 0.5f;
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::T) {
+			tonemap = (Tonemapper::Operator)((tonemap + 1) % 3);
+		}
+		if (e.type == sf::Event::KeyPressed && e.key.code == sf::Keyboard::S) {
+			renderThread.UpdateCamera([cameraStep](Camera& c) { c.MoveBackward(cameraStep); });
+		}
+		if (e.type == sf::Event::Resized) {
+			Render(window);
+		}
+	}
+}
+
+void Render(sf::RenderWindow& window) {
+	window.clear();
+	window.draw(sprite);
+	window.display();
+}
+
+//! Renders up to nSamples passes without any display work and writes the averaged film to output
+//! Stops early when adaptive sampling finds every pixel converged
+bool RenderBatch(Renderer& renderer, Denoiser& denoiser, const Tonemapper& tonemapper, unsigned nSamples, const std::string& output) {
+	std::cout << "Rendering " << w << "x" << h << " with " << nSamples << " samples per pixel on "
+		<< renderer.GetThreadCount() << " threads" << std::endl;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	unsigned reported = 0;
+	unsigned long long nPixelSamples = 0;
+	for (unsigned i = 1; i <= nSamples; i++) {
+		unsigned sampled = renderer.RenderPass();
+		nPixelSamples += sampled;
+		if (sampled == 0) {
+			std::cout << "  Converged after " << i - 1 << " passes" << std::endl;
+			break;
+		}
+		// Report every ten percent
+		unsigned progress = i * 10 / nSamples;
+		if (progress != reported) {
+			std::cout << "  " << progress * 10 << "%" << std::endl;
+			reported = progress;
+		}
+	}
+	double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::high_resolution_clock::now() - start).count() / 1000.0;
+	std::cout << "Rendered in " << seconds << " s, " << (double)nPixelSamples / (w * h)
+		<< " samples per pixel on average" << std::endl;
+
+	FilmImage result;
+	camera.film.Resolve(result);
+	if (denoise) {
+		start = std::chrono::high_resolution_clock::now();
+		denoiser.Denoise(result, result.color);
+		seconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::high_resolution_clock::now() - start).count() / 1000.0;
+		std::cout << "Denoised in " << seconds << " s" << std::endl;
+	}
+	if (!WriteImage(output, result, tonemapper))
+		return false;
+	std::cout << "Wrote " << output << std::endl;
+	return true;
+}
+
+//! Shows a snapshot of the averaged film
+//! The pixels are tonemapped straight into framebuffer, which the texture copies from without an sf::Image in between
+void UpdateTexture(const std::vector<Color>& pixels, Tonemapper& tonemapper, std::vector<unsigned char>& framebuffer, sf::Texture& texture) {
+	tonemapper.Convert(pixels, camera.film.GetWidth(), camera.film.GetHeight(), framebuffer);
+	texture.update(&framebuffer[0]);
+}
+
+//! Inserts the frame number before the extension, so render.exr becomes render_0001.exr
+static std::string GetFrameFileName(const std::string& output, unsigned frame) {
+	size_t dot = output.find_last_of('.');
+	size_t slash = output.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+		dot = output.size();
+	std::stringstream ss;
+	ss << output.substr(0, dot) << "_" << std::setw(4) << std::setfill('0') << frame << output.substr(dot);
+	return ss.str();
+}
+
+//! Renders every frame of the scene as RenderBatch does
+//! Between frames the scene is only refit to where everything moved, so setting up a frame takes next to no time
+bool RenderAnimation(Scene& scene, Renderer& renderer, Denoiser& denoiser, const Tonemapper& tonemapper, unsigned nSamples,
+	const std::string& output, float shutter) {
+	const SceneSettings& settings = scene.settings;
+	for (unsigned frame = 0; frame < settings.frames; frame++) {
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		float time = (float)frame / settings.frameRate;
+		scene.SetTime(time, shutter / settings.frameRate);
+		scene.SetupCamera(camera, time, shutter / settings.frameRate);
+		camera.film.Clear();
+		std::cout << "Frame " << frame << " of " << settings.frames << ", set up in " << std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::high_resolution_clock::now() - start).count() / 1000.0 << " ms" << std::endl;
+		if (!RenderBatch(renderer, denoiser, tonemapper, nSamples, GetFrameFileName(output, frame)))
+			return false;
+	}
+	return true;
 }
\ No newline at end of file